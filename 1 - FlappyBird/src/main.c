@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <time.h>
 #define SDL_MAIN_USE_CALLBACKS 1
+#include "Engine/FramePacer.h"
 #include "Objects.h"
 #include "SDL3/SDL.h"
 #include "SDL3/SDL_main.h"
@@ -27,16 +28,12 @@ typedef struct {
   SDL_Renderer *renderer;
   SDL_Palette *palette;
 
-  Uint64 lastFrameEndNS;
-  double targetTickTimeNS;
+  FramePacer *pacer;
+  Uint64 lastReportNS;
 
   GameState *gameState;
 } AppState;
 
-void setTargetTick(AppState *state, Uint64 FPS) {
-  state->targetTickTimeNS = SDL_NS_PER_SECOND * 1. / FPS;
-}
-
 void initPalette(SDL_Palette **palette) {
   SDL_Color background = {170, 85, 30, SDL_ALPHA_OPAQUE};
   SDL_Color bird = {255, 240, 0, SDL_ALPHA_OPAQUE};
@@ -65,8 +62,8 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv) {
   }
 
   AppState *state = SDL_malloc(sizeof(AppState));
-  state->lastFrameEndNS = 0;
-  setTargetTick(state, 60);
+  state->pacer = FramePacer_Create(60);
+  state->lastReportNS = 0;
   initPalette(&state->palette);
   Game_Init(&state->gameState);
   *appstate = state;
@@ -88,6 +85,7 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv) {
                     SDL_GetError());
     return SDL_APP_FAILURE;
   }
+  FramePacer_SetRenderer(state->pacer, state->renderer);
 
   return SDL_APP_CONTINUE;
 }
@@ -117,23 +115,27 @@ SDL_AppResult SDL_AppIterate(void *appstate) {
   AppState *state = appstate;
 
   auto startFrame = SDL_GetTicksNS();
-  auto deltaNS = startFrame - state->lastFrameEndNS;
-
-  if (deltaNS >= state->targetTickTimeNS) {
-    physicsStep(state, deltaNS);
-    drawApp(state);
-
-    auto endFrame = SDL_GetTicksNS();
-    auto frameTime = endFrame - startFrame;
-    auto elapsedSinceLast = endFrame - state->lastFrameEndNS;
-    double fps = (SDL_NS_PER_SECOND * 1. / elapsedSinceLast);
-
-    SDL_Log("Frame time: %f ms", frameTime * 1. / SDL_NS_PER_MS);
-    SDL_Log("Current FPS: %2.2f", fps);
-
-    state->lastFrameEndNS = endFrame;
+  auto deltaNS = FramePacer_BeginFrame(state->pacer);
+
+  physicsStep(state, deltaNS);
+  drawApp(state);
+
+  // Report once per second rather than on every frame
+  if (startFrame - state->lastReportNS >= SDL_NS_PER_SECOND) {
+    FramePacerStats stats;
+    FramePacer_GetStats(state->pacer, &stats);
+    SDL_Log("Frame time: %f ms (target %f ms)",
+            stats.lastWorkNS * 1. / SDL_NS_PER_MS,
+            stats.targetNS * 1. / SDL_NS_PER_MS);
+    if (stats.averageFrameNS > 0) {
+      SDL_Log("Current FPS: %2.2f",
+              SDL_NS_PER_SECOND * 1. / stats.averageFrameNS);
+    }
+    state->lastReportNS = startFrame;
   }
 
+  FramePacer_EndFrame(state->pacer, true);
+
   return SDL_APP_CONTINUE;
 }
 
@@ -150,5 +152,6 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result) {
   AppState *state = appstate;
   SDL_DestroyPalette(state->palette);
   Game_Free(state->gameState);
+  FramePacer_Free(state->pacer);
   SDL_free(state);
 }
@@ -25,40 +25,76 @@ typedef struct Entity Entity;
 struct Entity {
   void *memory;
   Position position;
+  Position previousPosition;
   Position size;
   void (*cleanup)(Entity *entity);
+  void (*prepare)(Entity *entity, SDL_Renderer *renderer);
   SDL_Texture *(*render)(const Entity *entity, const Level *level);
   void (*update)(Entity *entity, Uint64 deltaMS, Level *level);
 };
 
 void freeEntity(Entity *entity);
+void prepareEntity(Entity *entity, SDL_Renderer *renderer);
 SDL_Texture *renderEntity(const Entity *entity, const Level *level);
 void updateEntity(Entity *entity, Uint64 deltaMS, Level *level);
 
-Entity *
-createPlayerEntity(Level *level, Position start, SDL_Renderer *renderer);
+Entity *createPlayerEntity(Level *level, Position start);
 void Player_move(Entity *entity, Direction direction, Level *level);
 bool isPlayerJumping(const Entity *entity);
 
-Entity *createCarEntity(Level *level,
-                        Position start,
-                        Direction direction,
-                        unsigned int size,
-                        double speed,
-                        SDL_Renderer *renderer);
+typedef enum {
+  OBSTACLE_CAR = 0,
+  OBSTACLE_TURTLE,
+  OBSTACLE_LOG,
+} ObstacleKind;
 
-Entity *createTurtleEntity(Level *level,
-                           Position start,
-                           Direction direction,
-                           unsigned int size,
-                           double speed,
-                           SDL_Renderer *renderer);
+// A lane of obstacles that move together. The obstacles loop over the lane:
+// they appear just outside of the level, on the side they come from, cross it,
+// and appear again once they left it. The lane is a static pattern of
+// intervals along that loop, start[i] to start[i] + width[i], that scrolls by
+// offset cells. Only the offset changes over time.
+//
+// The pattern is also kept as one flag per cell of the loop, covered[k] telling
+// whether an obstacle overlaps the cell from k to k + 1, counted from the low
+// end of the pattern. As obstacles start on whole cells, whether a cell of the
+// level is occupied is answered by looking up the one or two pattern cells it
+// falls on.
+typedef struct {
+  ObstacleKind kind;
+  unsigned int row;
+  // Cells per millisecond, rightwards if positive
+  double velocity;
+  // The length of the loop
+  double period;
+  // The abscissa where the loop starts, which is then followed in the
+  // direction of the lane
+  double origin;
+  double offset;
+  // The offset before the last update, to interpolate the rendering
+  double previousOffset;
+  double *start;
+  double *width;
+  bool *covered;
+  unsigned int size;
+  unsigned int capacity;
+} Lane;
 
-Entity *createLogEntity(Level *level,
-                        Position start,
-                        Direction direction,
-                        unsigned int size,
-                        double speed,
-                        SDL_Renderer *renderer);
+void initLane(Lane *lane,
+              const Level *level,
+              ObstacleKind kind,
+              unsigned int row,
+              Direction direction,
+              double speed,
+              unsigned int capacity,
+              unsigned int maxWidth);
+void freeLane(Lane *lane);
+void addObstacle(Lane *lane, double x, unsigned int width);
+void updateLanes(Lane *lanes, unsigned int count, Uint64 timeMS);
+void seekLanes(Lane *lanes, unsigned int count, Uint64 timeMS);
+double getLaneOffset(const Lane *lane, Uint64 timeMS);
+double interpolateLaneOffset(const Lane *lane, float alpha);
+double getObstacleX(const Lane *lane, unsigned int obstacle, double offset);
+bool isLaneCellOccupied(const Lane *lane, int column, double offset);
+SDL_Color getLaneColor(const Lane *lane);
 
-void movePlayerWithObstacle(const Entity *obstacle, Entity *player, Uint64 deltaMS);
+void movePlayerWithLane(const Lane *lane, Entity *player, Uint64 deltaMS);
@@ -37,12 +37,19 @@ typedef struct Level Level;
 Level *createLevel(double speed,
                    unsigned int carLanes,
                    unsigned int riverLanes,
-                   bool safeZones,
-                   SDL_Rect *windowSize,
-                   SDL_Renderer *renderer);
+                   bool safeZones);
+void prepareLevel(Level *level,
+                  const SDL_Rect *windowSize,
+                  SDL_Renderer *renderer);
+void layoutLevel(Level *level, const SDL_Rect *windowSize);
 void freeLevel(Level *level);
 LevelStatus updateLevel(Level *level, Uint64 deltaMS);
-void renderLevel(const Level *level, SDL_Renderer *renderer);
+void seekLevel(Level *level, Uint64 timeMS);
+bool isCellOccupied(const Level *level,
+                    unsigned int row,
+                    int column,
+                    Uint64 timeMS);
+void renderLevel(const Level *level, SDL_Renderer *renderer, float alpha);
 void moveEventLevel(Level *level, Direction direction);
 
 unsigned int getLevelWidth(const Level *level);
@@ -20,5 +20,5 @@
 State *createStartState();
 State *createOptionsState();
 State *createGameState();
-State *createGameOverState();
-State *createVictoryState();
+State *createGameOverState(StateManager *manager);
+State *createVictoryState(StateManager *manager);
@@ -29,6 +29,10 @@
 #define MAX_LOGS_PER_LANE 5
 #define ENTITY_MARGIN_X (2. / CELL_WIDTH)
 #define ENTITY_MARGIN_Y (2. / CELL_HEIGHT)
+// Collisions are checked on masks sampling each row several times per cell
+#define OCCUPANCY_SAMPLES 4
+#define OCCUPANCY_BITS (COLUMNS * OCCUPANCY_SAMPLES)
+#define OCCUPANCY_WORDS ((OCCUPANCY_BITS + 63) / 64)
 
 enum InPalette {
   OUTSIDE = 0,
@@ -39,16 +43,14 @@ enum InPalette {
   SIZE_IN_PALETTE,
 };
 
-typedef struct {
-  Entity **obstacles;
-  unsigned int size;
-} Obstacles;
-
 struct Level {
   Entity *player;
-  Obstacles cars;
-  Obstacles logs;
-  Obstacles turtles;
+  Lane *lanes;
+  unsigned int laneCount;
+  // The index of the lane on each row, or -1
+  int *laneOfRow;
+  // OCCUPANCY_WORDS words per lane, with the samples covered by an obstacle
+  Uint64 *occupancy;
   double speed;
   unsigned int carLanes;
   unsigned int riverLanes;
@@ -56,6 +58,8 @@ struct Level {
   SDL_Rect boundaries;
   SDL_Rect windowSize;
   SDL_Palette *palette;
+  // How long the obstacles have been moving
+  Uint64 timeMS;
 };
 
 static void gridToGlobalPosition(const Level *level,
@@ -66,26 +70,29 @@ static void gridToGlobalPosition(const Level *level,
   *y = grid->y * CELL_HEIGHT + level->boundaries.y;
 }
 
-static void createObstacles(Level *level, SDL_Renderer *renderer) {
-  unsigned int nCars = MAX_CARS_PER_LANE * level->carLanes;
-  level->cars.size = nCars;
-  level->cars.obstacles = SDL_malloc(nCars * sizeof(Entity *));
-  for (unsigned int i = 0; i < nCars; i++) {
-    level->cars.obstacles[i] = nullptr;
-  }
-
-  unsigned int nTurtles = MAX_TURTLES_PER_LANE * level->riverLanes;
-  level->turtles.size = nTurtles;
-  level->turtles.obstacles = SDL_malloc(nTurtles * sizeof(Entity *));
-  for (unsigned int i = 0; i < nTurtles; i++) {
-    level->turtles.obstacles[i] = nullptr;
-  }
+static Lane *addLane(Level *level,
+                     ObstacleKind kind,
+                     unsigned int row,
+                     Direction direction,
+                     double speed,
+                     unsigned int capacity,
+                     unsigned int width) {
+  level->laneOfRow[row] = level->laneCount;
+  Lane *lane = &level->lanes[level->laneCount++];
+  initLane(lane, level, kind, row, direction, speed, capacity, width);
+  return lane;
+}
 
-  unsigned int nLogs = MAX_LOGS_PER_LANE * level->riverLanes;
-  level->logs.size = nLogs;
-  level->logs.obstacles = SDL_malloc(nLogs * sizeof(Entity *));
-  for (unsigned int i = 0; i < nLogs; i++) {
-    level->logs.obstacles[i] = nullptr;
+static void createObstacles(Level *level) {
+  unsigned int rows = getLevelHeight(level);
+  level->lanes =
+      SDL_malloc((level->carLanes + level->riverLanes) * sizeof(Lane));
+  level->laneCount = 0;
+  level->laneOfRow = SDL_malloc(rows * sizeof(int));
+  level->occupancy = SDL_malloc((level->carLanes + level->riverLanes) *
+                                OCCUPANCY_WORDS * sizeof(Uint64));
+  for (unsigned int row = 0; row < rows; row++) {
+    level->laneOfRow[row] = -1;
   }
 
   for (unsigned int lane = 0; lane < level->carLanes; lane++) {
@@ -103,12 +110,11 @@ static void createObstacles(Level *level, SDL_Renderer *renderer) {
       gap = 5;
     }
 
+    unsigned int row = 1 + level->riverLanes + 1 + level->carLanes - lane - 1;
+    Lane *cars = addLane(
+        level, OBSTACLE_CAR, row, direction, speed, MAX_CARS_PER_LANE, size);
     for (unsigned int car = 0; car < 4 - (2 * (lane % 2)); car++) {
-      Position start = {.x = (size + gap) * car + (lane % 3),
-                        .y = 1 + level->riverLanes + 1 + level->carLanes -
-                             lane - 1};
-      level->cars.obstacles[MAX_CARS_PER_LANE * lane + car] =
-          createCarEntity(level, start, direction, size, speed, renderer);
+      addObstacle(cars, (size + gap) * car + (lane % 3), size);
     }
   }
 
@@ -117,6 +123,7 @@ static void createObstacles(Level *level, SDL_Renderer *renderer) {
     unsigned int size = 3;
     Direction direction;
     unsigned int gap;
+    unsigned int row = 1 + level->riverLanes - lane - 1;
 
     if (lane % 3 == 0) { // Turtles
       if (lane % 2 == 0) {
@@ -128,11 +135,15 @@ static void createObstacles(Level *level, SDL_Renderer *renderer) {
         gap = 5;
       }
 
+      Lane *turtles = addLane(level,
+                              OBSTACLE_TURTLE,
+                              row,
+                              direction,
+                              speed,
+                              MAX_TURTLES_PER_LANE,
+                              size);
       for (unsigned int turtle = 0; turtle < 3; turtle++) {
-        Position start = {.x = (size + gap) * turtle + 2 * (lane % 4),
-                          .y = 1 + level->riverLanes - lane - 1};
-        level->turtles.obstacles[MAX_TURTLES_PER_LANE * lane + turtle] =
-            createTurtleEntity(level, start, direction, size, speed, renderer);
+        addObstacle(turtles, (size + gap) * turtle + 2 * (lane % 4), size);
       }
     } else { // Logs
       if (lane % 2 == 1) {
@@ -146,34 +157,70 @@ static void createObstacles(Level *level, SDL_Renderer *renderer) {
         gap = 3;
       }
 
+      Lane *logs = addLane(
+          level, OBSTACLE_LOG, row, direction, speed, MAX_LOGS_PER_LANE, size);
       for (unsigned int log = 0; log < 3; log++) {
-        Position start = {.x = (size + gap) * log + (lane % 4),
-                          .y = 1 + level->riverLanes - lane - 1};
-        level->logs.obstacles[MAX_LOGS_PER_LANE * lane + log] =
-            createLogEntity(level, start, direction, size, speed, renderer);
+        addObstacle(logs, (size + gap) * log + (lane % 4), size);
       }
     }
   }
 }
 
+// Sets the samples of the mask whose centers lie strictly between from and
+// to, given in cells. Samples outside of the level are dropped.
+static void rasterizeSpan(Uint64 *mask, double from, double to) {
+  double firstSample = floor(from * OCCUPANCY_SAMPLES - 0.5) + 1;
+  double lastSample = ceil(to * OCCUPANCY_SAMPLES - 0.5);
+  int first = (int)SDL_clamp(firstSample, 0, OCCUPANCY_BITS);
+  int last = (int)SDL_clamp(lastSample, 0, OCCUPANCY_BITS);
+  while (first < last) {
+    int bit = first % 64;
+    int count = SDL_min(64 - bit, last - first);
+    Uint64 bits = count == 64 ? ~(Uint64)0 : ((Uint64)1 << count) - 1;
+    mask[first / 64] |= bits << bit;
+    first += count;
+  }
+}
+
+static bool masksOverlap(const Uint64 *a, const Uint64 *b) {
+  for (unsigned int word = 0; word < OCCUPANCY_WORDS; word++) {
+    if ((a[word] & b[word]) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Rebuilds the occupancy masks from the current positions of the obstacles
+static void rasterizeLanes(Level *level) {
+  for (unsigned int l = 0; l < level->laneCount; l++) {
+    const Lane *lane = &level->lanes[l];
+    Uint64 *mask = &level->occupancy[l * OCCUPANCY_WORDS];
+    SDL_memset(mask, 0, OCCUPANCY_WORDS * sizeof(Uint64));
+    for (unsigned int i = 0; i < lane->size; i++) {
+      double x = getObstacleX(lane, i, lane->offset);
+      rasterizeSpan(mask, x + ENTITY_MARGIN_X, x + lane->width[i]);
+    }
+  }
+}
+
 Level *createLevel(double speed,
                    unsigned int carLanes,
                    unsigned int riverLanes,
-                   bool safeZones,
-                   SDL_Rect *windowSize,
-                   SDL_Renderer *renderer) {
+                   bool safeZones) {
   Level *level = SDL_malloc(sizeof(Level));
   level->speed = speed;
   level->carLanes = carLanes;
   level->riverLanes = riverLanes;
   level->safeZones = safeZones;
-  level->windowSize = *windowSize;
+  level->timeMS = 0;
+  level->windowSize = (SDL_Rect){.x = 0, .y = 0, .w = 0, .h = 0};
   unsigned int nLines = getLevelHeight(level);
 
   level->boundaries.w = COLUMNS * CELL_WIDTH;
   level->boundaries.h = nLines * CELL_HEIGHT;
-  level->boundaries.x = (windowSize->w - level->boundaries.w) / 2.;
-  level->boundaries.y = (windowSize->h - level->boundaries.h) / 2.;
+  level->boundaries.x = 0;
+  level->boundaries.y = 0;
 
   level->palette = SDL_CreatePalette(SIZE_IN_PALETTE);
   SDL_Color colors[SIZE_IN_PALETTE];
@@ -201,70 +248,76 @@ Level *createLevel(double speed,
   SDL_SetPaletteColors(level->palette, colors, 0, SIZE_IN_PALETTE);
 
   Position start = {.x = floor(COLUMNS / 2.), .y = nLines - 1};
-  level->player = createPlayerEntity(level, start, renderer);
+  level->player = createPlayerEntity(level, start);
 
-  createObstacles(level, renderer);
+  createObstacles(level);
+  rasterizeLanes(level);
 
   return level;
 }
 
-void freeLevel(Level *level) {
-  freeEntity(level->player);
+void layoutLevel(Level *level, const SDL_Rect *windowSize) {
+  level->windowSize = *windowSize;
+  level->boundaries.x = (windowSize->w - level->boundaries.w) / 2.;
+  level->boundaries.y = (windowSize->h - level->boundaries.h) / 2.;
+}
 
-  for (unsigned int i = 0; i < level->cars.size; i++) {
-    if (level->cars.obstacles[i] != nullptr) {
-      freeEntity(level->cars.obstacles[i]);
-    }
-  }
-  SDL_free(level->cars.obstacles);
+void prepareLevel(Level *level,
+                  const SDL_Rect *windowSize,
+                  SDL_Renderer *renderer) {
+  layoutLevel(level, windowSize);
 
-  for (unsigned int i = 0; i < level->turtles.size; i++) {
-    if (level->turtles.obstacles[i] != nullptr) {
-      freeEntity(level->turtles.obstacles[i]);
-    }
-  }
-  SDL_free(level->turtles.obstacles);
+  prepareEntity(level->player, renderer);
+}
 
-  for (unsigned int i = 0; i < level->logs.size; i++) {
-    if (level->logs.obstacles[i] != nullptr) {
-      freeEntity(level->logs.obstacles[i]);
-    }
+void freeLevel(Level *level) {
+  freeEntity(level->player);
+  for (unsigned int i = 0; i < level->laneCount; i++) {
+    freeLane(&level->lanes[i]);
   }
-  SDL_free(level->logs.obstacles);
+  SDL_free(level->lanes);
+  SDL_free(level->laneOfRow);
+  SDL_free(level->occupancy);
 
   SDL_DestroyPalette(level->palette);
   SDL_free(level);
 }
 
-static void
-updateObstacles(Level *level, Uint64 deltaMS, Obstacles *obstacles) {
-  for (unsigned int i = 0; i < obstacles->size; i++) {
-    if (obstacles->obstacles[i] != nullptr) {
-      updateEntity(obstacles->obstacles[i], deltaMS, level);
+// Finds a lane with an obstacle touching the player, or returns nullptr. Only
+// the rows the player overlaps are searched: the one it is on, and the next
+// one while it jumps. Horizontally, the footprint of the player is matched
+// against the occupancy masks.
+static const Lane *findLaneUnderPlayer(const Level *level, bool river) {
+  const Entity *player = level->player;
+  double top = player->position.y + ENTITY_MARGIN_Y;
+  double bottom = player->position.y + player->size.y;
+  Uint64 footprint[OCCUPANCY_WORDS] = {};
+  rasterizeSpan(footprint,
+                player->position.x + ENTITY_MARGIN_X,
+                player->position.x + player->size.x);
+
+  int firstRow = SDL_max(0, (int)floor(player->position.y));
+  int lastRow = SDL_min((int)getLevelHeight(level), firstRow + 2);
+  for (int row = firstRow; row < lastRow; row++) {
+    if (level->laneOfRow[row] == -1 || row + ENTITY_MARGIN_Y >= bottom ||
+        row + 1 <= top) {
+      continue;
+    }
+    const Lane *lane = &level->lanes[level->laneOfRow[row]];
+    if ((lane->kind != OBSTACLE_CAR) != river) {
+      continue;
+    }
+    const Uint64 *mask =
+        &level->occupancy[level->laneOfRow[row] * OCCUPANCY_WORDS];
+    if (masksOverlap(footprint, mask)) {
+      return lane;
     }
   }
+  return nullptr;
 }
 
 static bool isHitByCar(const Level *level) {
-  const Entity *player = level->player;
-  for (unsigned int i = 0; i < level->cars.size; i++) {
-    const Entity *car = level->cars.obstacles[i];
-    if (car != nullptr) {
-      SDL_FRect playerRect = {.x = player->position.x + ENTITY_MARGIN_X,
-                              .y = player->position.y + ENTITY_MARGIN_Y,
-                              .w = player->size.x - ENTITY_MARGIN_X,
-                              .h = player->size.y - ENTITY_MARGIN_Y};
-      SDL_FRect carRect = {.x = car->position.x + ENTITY_MARGIN_X,
-                           .y = car->position.y + ENTITY_MARGIN_Y,
-                           .w = car->size.x - ENTITY_MARGIN_X,
-                           .h = car->size.y - ENTITY_MARGIN_Y};
-      SDL_FRect intersection;
-      if (SDL_GetRectIntersectionFloat(&playerRect, &carRect, &intersection)) {
-        return true;
-      }
-    }
-  }
-  return false;
+  return findLaneUnderPlayer(level, false) != nullptr;
 }
 
 static bool isInWaterOrMoveWithObstacle(Level *level, Uint64 deltaMS) {
@@ -278,42 +331,10 @@ static bool isInWaterOrMoveWithObstacle(Level *level, Uint64 deltaMS) {
     return true;
   }
 
-  for (unsigned int i = 0; i < level->logs.size; i++) {
-    const Entity *log = level->logs.obstacles[i];
-    if (log != nullptr) {
-      SDL_FRect playerRect = {.x = player->position.x + ENTITY_MARGIN_X,
-                              .y = player->position.y + ENTITY_MARGIN_Y,
-                              .w = player->size.x - ENTITY_MARGIN_X,
-                              .h = player->size.y - ENTITY_MARGIN_Y};
-      SDL_FRect logRect = {.x = log->position.x + ENTITY_MARGIN_X,
-                           .y = log->position.y + ENTITY_MARGIN_Y,
-                           .w = log->size.x - ENTITY_MARGIN_X,
-                           .h = log->size.y - ENTITY_MARGIN_Y};
-      SDL_FRect intersection;
-      if (SDL_GetRectIntersectionFloat(&playerRect, &logRect, &intersection)) {
-        movePlayerWithObstacle(log, player, deltaMS);
-        return false;
-      }
-    }
-  }
-  for (unsigned int i = 0; i < level->turtles.size; i++) {
-    const Entity *turtle = level->turtles.obstacles[i];
-    if (turtle != nullptr) {
-      SDL_FRect playerRect = {.x = player->position.x + ENTITY_MARGIN_X,
-                              .y = player->position.y + ENTITY_MARGIN_Y,
-                              .w = player->size.x - ENTITY_MARGIN_X,
-                              .h = player->size.y - ENTITY_MARGIN_Y};
-      SDL_FRect turtleRect = {.x = turtle->position.x + ENTITY_MARGIN_X,
-                              .y = turtle->position.y + ENTITY_MARGIN_Y,
-                              .w = turtle->size.x - ENTITY_MARGIN_X,
-                              .h = turtle->size.y - ENTITY_MARGIN_Y};
-      SDL_FRect intersection;
-      if (SDL_GetRectIntersectionFloat(
-              &playerRect, &turtleRect, &intersection)) {
-        movePlayerWithObstacle(turtle, player, deltaMS);
-        return false;
-      }
-    }
+  const Lane *lane = findLaneUnderPlayer(level, true);
+  if (lane != nullptr) {
+    movePlayerWithLane(lane, player, deltaMS);
+    return false;
   }
   return true;
 }
@@ -328,9 +349,9 @@ static bool isInTarget(Level *level) {
 }
 
 LevelStatus updateLevel(Level *level, Uint64 deltaMS) {
-  updateObstacles(level, deltaMS, &level->cars);
-  updateObstacles(level, deltaMS, &level->turtles);
-  updateObstacles(level, deltaMS, &level->logs);
+  level->timeMS += deltaMS;
+  updateLanes(level->lanes, level->laneCount, level->timeMS);
+  rasterizeLanes(level);
   updateEntity(level->player, deltaMS, level);
 
   if (isHitByCar(level) || isInWaterOrMoveWithObstacle(level, deltaMS)) {
@@ -343,6 +364,25 @@ LevelStatus updateLevel(Level *level, Uint64 deltaMS) {
   return CONTINUE;
 }
 
+// Moves the obstacles to where they are at the given time, without simulating
+// what happens in between
+void seekLevel(Level *level, Uint64 timeMS) {
+  level->timeMS = timeMS;
+  seekLanes(level->lanes, level->laneCount, timeMS);
+  rasterizeLanes(level);
+}
+
+bool isCellOccupied(const Level *level,
+                    unsigned int row,
+                    int column,
+                    Uint64 timeMS) {
+  if (row >= getLevelHeight(level) || level->laneOfRow[row] == -1) {
+    return false;
+  }
+  const Lane *lane = &level->lanes[level->laneOfRow[row]];
+  return isLaneCellOccupied(lane, column, getLaneOffset(lane, timeMS));
+}
+
 inline static void renderOutside(const Level *level, SDL_Renderer *renderer) {
   SDL_Color color = level->palette->colors[OUTSIDE];
   SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
@@ -418,30 +458,58 @@ inline static void renderRiverLanes(const Level *level,
   SDL_RenderFillRect(renderer, &rect);
 }
 
+static Position interpolatePosition(const Entity *entity, float alpha) {
+  Position delta = {.x = entity->position.x - entity->previousPosition.x,
+                    .y = entity->position.y - entity->previousPosition.y};
+  // No entity moves by a whole cell during a tick, unless it just warped to
+  // the other side of the level.
+  if (fabs(delta.x) >= 1 || fabs(delta.y) >= 1) {
+    return entity->position;
+  }
+  Position position = {.x = entity->previousPosition.x + delta.x * alpha,
+                       .y = entity->previousPosition.y + delta.y * alpha};
+  return position;
+}
+
 static void renderOneEntity(const Level *level,
                             const Entity *entity,
+                            float alpha,
                             SDL_Renderer *renderer) {
   SDL_Texture *texture = renderEntity(entity, level);
   SDL_FRect dstrect = {.x = 0,
                        .y = 0,
                        .w = entity->size.x * CELL_WIDTH,
                        .h = entity->size.y * CELL_HEIGHT};
-  gridToGlobalPosition(level, &entity->position, &dstrect.x, &dstrect.y);
+  Position position = interpolatePosition(entity, alpha);
+  gridToGlobalPosition(level, &position, &dstrect.x, &dstrect.y);
 
   SDL_RenderTexture(renderer, texture, nullptr, &dstrect);
 }
 
-static void renderObstacles(const Level *level,
-                            const Obstacles *obstacles,
-                            SDL_Renderer *renderer) {
-  for (unsigned int i = 0; i < obstacles->size; i++) {
-    if (obstacles->obstacles[i] != nullptr) {
-      renderOneEntity(level, obstacles->obstacles[i], renderer);
+// Draws the lanes of cars, or the other ones
+static void renderLanes(const Level *level,
+                        bool cars,
+                        float alpha,
+                        SDL_Renderer *renderer) {
+  for (unsigned int l = 0; l < level->laneCount; l++) {
+    const Lane *lane = &level->lanes[l];
+    if ((lane->kind == OBSTACLE_CAR) != cars) {
+      continue;
+    }
+    SDL_Color color = getLaneColor(lane);
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    double offset = interpolateLaneOffset(lane, alpha);
+    for (unsigned int i = 0; i < lane->size; i++) {
+      Position position = {.x = getObstacleX(lane, i, offset), .y = lane->row};
+      SDL_FRect dstrect = {
+          .x = 0, .y = 0, .w = lane->width[i] * CELL_WIDTH, .h = CELL_HEIGHT};
+      gridToGlobalPosition(level, &position, &dstrect.x, &dstrect.y);
+      SDL_RenderFillRect(renderer, &dstrect);
     }
   }
 }
 
-void renderLevel(const Level *level, SDL_Renderer *renderer) {
+void renderLevel(const Level *level, SDL_Renderer *renderer, float alpha) {
   // Since the background never changes, it would be best to prepare a texture
   // once and reuse it. Optimizing this project is not a priority, though.
   renderSafeLanes(level, renderer);
@@ -449,10 +517,9 @@ void renderLevel(const Level *level, SDL_Renderer *renderer) {
   renderCarLanes(level, renderer);
   renderRiverLanes(level, renderer);
 
-  renderObstacles(level, &level->turtles, renderer);
-  renderObstacles(level, &level->logs, renderer);
-  renderOneEntity(level, level->player, renderer);
-  renderObstacles(level, &level->cars, renderer);
+  renderLanes(level, false, alpha, renderer);
+  renderOneEntity(level, level->player, alpha, renderer);
+  renderLanes(level, true, alpha, renderer);
 
   // The outside is drawn last to hide the obstacles that go offscreen.
   renderOutside(level, renderer);
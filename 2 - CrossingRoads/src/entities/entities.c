@@ -24,6 +24,12 @@ void freeEntity(Entity *entity) {
   SDL_free(entity);
 }
 
+void prepareEntity(Entity *entity, SDL_Renderer *renderer) {
+  if (entity != nullptr && entity->prepare != nullptr) {
+    entity->prepare(entity, renderer);
+  }
+}
+
 SDL_Texture* renderEntity(const Entity *entity, const Level *level) {
   if (entity != nullptr && entity->render != nullptr) {
     return entity->render(entity, level);
@@ -33,6 +39,7 @@ SDL_Texture* renderEntity(const Entity *entity, const Level *level) {
 
 void updateEntity(Entity *entity, Uint64 deltaMS, Level *level) {
   if (entity != nullptr && entity->update != nullptr) {
+    entity->previousPosition = entity->position;
     entity->update(entity, deltaMS, level);
   }
 }
@@ -20,147 +20,137 @@
 #include "Level.h"
 #include "SDL3/SDL_log.h"
 #include "SDL3/SDL_pixels.h"
-#include "SDL3/SDL_render.h"
+#include <math.h>
 
 #define MARGIN 2
 #define TIME_CELL 600
 #define MOVEMENT_SPEED(speed) (speed * 1. / TIME_CELL)
 
-typedef struct {
-  SDL_Texture *texture;
-  Direction direction;
-  double speed;
-} Memory;
+static const SDL_Color colors[] = {
+    [OBSTACLE_CAR] = {.r = 160, .g = 25, .b = 25, .a = SDL_ALPHA_OPAQUE},
+    [OBSTACLE_TURTLE] = {.r = 25, .g = 150, .b = 50, .a = SDL_ALPHA_OPAQUE},
+    [OBSTACLE_LOG] = {.r = 153, .g = 88, .b = 42, .a = SDL_ALPHA_OPAQUE},
+};
 
-static void cleanup(Entity *entity) {
-  Memory *memory = entity->memory;
-  SDL_DestroyTexture(memory->texture);
-  SDL_free(memory);
+static inline double wrap(double distance, double period) {
+  return distance - period * floor(distance / period);
 }
 
-static SDL_Texture *render(const Entity *entity, const Level *) {
-  const Memory *memory = entity->memory;
-  return memory->texture;
-}
-
-static void warp(Entity *entity, const Level *level) {
-  Memory *memory = entity->memory;
+void initLane(Lane *lane,
+              const Level *level,
+              ObstacleKind kind,
+              unsigned int row,
+              Direction direction,
+              double speed,
+              unsigned int capacity,
+              unsigned int maxWidth) {
+  if (direction != LEFT && direction != RIGHT) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                 "Invalid direction for an obstacle");
+    direction = RIGHT;
+  }
   unsigned int width = getLevelWidth(level);
-  if (memory->direction == LEFT && entity->position.x + entity->size.x <= 0) {
-    entity->position.x = width + MARGIN;
-  } else if (memory->direction == RIGHT && entity->position.x >= width) {
-    entity->position.x = -MARGIN - entity->size.x;
+  lane->kind = kind;
+  lane->row = row;
+  // The loop is long enough for the widest obstacle to be out of the level
+  // when it goes back to the start
+  lane->period = width + MARGIN + maxWidth;
+  if (direction == LEFT) {
+    lane->velocity = -MOVEMENT_SPEED(speed);
+    lane->origin = width + MARGIN;
+  } else {
+    lane->velocity = MOVEMENT_SPEED(speed);
+    lane->origin = -MARGIN - (double)maxWidth;
   }
+  lane->offset = 0;
+  lane->previousOffset = 0;
+  lane->start = SDL_malloc(2 * capacity * sizeof(double));
+  lane->width = lane->start + capacity;
+  lane->covered = SDL_calloc((size_t)lane->period, sizeof(bool));
+  lane->size = 0;
+  lane->capacity = capacity;
 }
 
-static void move(Entity *entity, Direction direction, double distance) {
-  switch (direction) {
-  case LEFT:
-    entity->position.x -= distance;
-    break;
-  case RIGHT:
-    entity->position.x += distance;
-    break;
-  case UP:
-  case DOWN:
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                 "Invalid direction for an obstacle");
-    break;
-  }
+void freeLane(Lane *lane) {
+  SDL_free(lane->start);
+  SDL_free(lane->covered);
+  lane->start = lane->width = nullptr;
+  lane->covered = nullptr;
+  lane->size = lane->capacity = 0;
 }
 
-static void update(Entity *entity, Uint64 deltaMS, Level *level) {
-  Memory *memory = entity->memory;
-  move(entity, memory->direction, deltaMS * MOVEMENT_SPEED(memory->speed));
-  warp(entity, level);
+// x is the abscissa of the obstacle when the offset is 0
+void addObstacle(Lane *lane, double x, unsigned int width) {
+  if (lane->size == lane->capacity) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Too many obstacles in a lane");
+    return;
+  }
+  unsigned int i = lane->size++;
+  double distance = lane->velocity < 0 ? lane->origin - x : x - lane->origin;
+  lane->start[i] = wrap(distance, lane->period);
+  lane->width[i] = width;
+
+  // Leftwards, the obstacle extends towards the start of the loop
+  double low = lane->velocity < 0 ? lane->start[i] - width : lane->start[i];
+  double high = low + width;
+  for (double cell = floor(low); cell < high; cell++) {
+    lane->covered[(unsigned int)wrap(cell, lane->period)] = true;
+  }
 }
 
-inline static Entity *createGeneric(Level *level,
-                                    Position start,
-                                    Direction direction,
-                                    unsigned int size,
-                                    double speed,
-                                    SDL_Renderer *renderer) {
-  Entity *entity = SDL_malloc(sizeof(Entity));
-  entity->memory = SDL_malloc(sizeof(Memory));
-  entity->position = start;
-  entity->size.x = size;
-  entity->size.y = 1;
-  entity->cleanup = cleanup;
-  entity->render = render;
-  entity->update = update;
-
-  Memory *memory = entity->memory;
-  memory->direction = direction;
-  memory->speed = speed;
-  memory->texture = SDL_CreateTexture(renderer,
-                                      SDL_PIXELFORMAT_RGBA32,
-                                      SDL_TEXTUREACCESS_STREAMING,
-                                      size * CELL_WIDTH,
-                                      CELL_HEIGHT);
-
-  warp(entity, level);
-  return entity;
+double getLaneOffset(const Lane *lane, Uint64 timeMS) {
+  return wrap(fabs(lane->velocity) * timeMS, lane->period);
 }
 
-inline static void fillTexture(SDL_Texture *texture, SDL_Color *color) {
-  SDL_Surface *surface;
-  if (SDL_LockTextureToSurface(texture, nullptr, &surface)) {
-    const SDL_PixelFormatDetails *formatDetails =
-        SDL_GetPixelFormatDetails(surface->format);
+// The lanes only scroll: updating them does not depend on their obstacles
+void updateLanes(Lane *lanes, unsigned int count, Uint64 timeMS) {
+  for (unsigned int i = 0; i < count; i++) {
+    lanes[i].previousOffset = lanes[i].offset;
+    lanes[i].offset = getLaneOffset(&lanes[i], timeMS);
+  }
+}
 
-    SDL_FillSurfaceRect(
-        surface,
-        nullptr,
-        SDL_MapRGBA(
-            formatDetails, nullptr, color->r, color->g, color->b, color->a));
+void seekLanes(Lane *lanes, unsigned int count, Uint64 timeMS) {
+  for (unsigned int i = 0; i < count; i++) {
+    lanes[i].offset = getLaneOffset(&lanes[i], timeMS);
+    // Nothing to interpolate from
+    lanes[i].previousOffset = lanes[i].offset;
+  }
+}
 
-    SDL_UnlockTexture(texture);
+double interpolateLaneOffset(const Lane *lane, float alpha) {
+  // The offset only grows, except when it goes back to the start of the loop
+  double delta = lane->offset - lane->previousOffset;
+  if (delta < 0) {
+    delta += lane->period;
   }
+  return wrap(lane->previousOffset + delta * alpha, lane->period);
 }
 
-Entity *createCarEntity(Level *level,
-                        Position start,
-                        Direction direction,
-                        unsigned int size,
-                        double speed,
-                        SDL_Renderer *renderer) {
-  Entity *car = createGeneric(level, start, direction, size, speed, renderer);
-  Memory *memory = car->memory;
-  SDL_Color color = {.r = 160, .g = 25, .b = 25, .a = SDL_ALPHA_OPAQUE};
-  fillTexture(memory->texture, &color);
-
-  return car;
+double getObstacleX(const Lane *lane, unsigned int obstacle, double offset) {
+  double distance = wrap(lane->start[obstacle] + offset, lane->period);
+  return lane->origin + copysign(distance, lane->velocity);
 }
 
-Entity *createTurtleEntity(Level *level,
-                           Position start,
-                           Direction direction,
-                           unsigned int size,
-                           double speed,
-                           SDL_Renderer *renderer) {
-  Entity *turtle =
-      createGeneric(level, start, direction, size, speed, renderer);
-  Memory *memory = turtle->memory;
-  SDL_Color color = {.r = 25, .g = 150, .b = 50, .a = SDL_ALPHA_OPAQUE};
-  fillTexture(memory->texture, &color);
-  return turtle;
+// The pattern scrolled by offset is looked up where the cell falls, in
+// constant time
+bool isLaneCellOccupied(const Lane *lane, int column, double offset) {
+  unsigned int cells = (unsigned int)lane->period;
+  double low = lane->velocity < 0 ? lane->origin - column - 1
+                                  : column - lane->origin;
+  low = wrap(low - offset, lane->period);
+  unsigned int first = (unsigned int)low;
+  if (lane->covered[first % cells]) {
+    return true;
+  }
+  // A cell not aligned with the pattern also overlaps the next pattern cell
+  return low > first && lane->covered[(first + 1) % cells];
 }
 
-Entity *createLogEntity(Level *level,
-                        Position start,
-                        Direction direction,
-                        unsigned int size,
-                        double speed,
-                        SDL_Renderer *renderer) {
-  Entity *log = createGeneric(level, start, direction, size, speed, renderer);
-  Memory *memory = log->memory;
-  SDL_Color color = {.r = 153, .g = 88, .b = 42, .a = SDL_ALPHA_OPAQUE};
-  fillTexture(memory->texture, &color);
-  return log;
+SDL_Color getLaneColor(const Lane *lane) {
+  return colors[lane->kind];
 }
 
-void movePlayerWithObstacle(const Entity *obstacle, Entity *player, Uint64 deltaMS) {
-  Memory *memory = obstacle->memory;
-  move(player, memory->direction, deltaMS * MOVEMENT_SPEED(memory->speed));
+void movePlayerWithLane(const Lane *lane, Entity *player, Uint64 deltaMS) {
+  player->position.x += deltaMS * lane->velocity;
 }
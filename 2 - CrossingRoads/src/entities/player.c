@@ -46,10 +46,21 @@ typedef struct {
 static void cleanup(Entity *entity) {
   Memory *memory = entity->memory;
   SDL_DestroyPalette(memory->palette);
-  SDL_DestroyTexture(memory->texture);
+  if (memory->texture != nullptr) {
+    SDL_DestroyTexture(memory->texture);
+  }
   SDL_free(memory);
 }
 
+static void prepare(Entity *entity, SDL_Renderer *renderer) {
+  Memory *memory = entity->memory;
+  memory->texture = SDL_CreateTexture(renderer,
+                                      SDL_PIXELFORMAT_RGBA32,
+                                      SDL_TEXTUREACCESS_STREAMING,
+                                      CELL_WIDTH,
+                                      CELL_HEIGHT);
+}
+
 static void update(Entity *entity, Uint64 deltaMS, Level *) {
   Memory *memory = entity->memory;
 
@@ -104,12 +115,14 @@ static SDL_Texture *render(const Entity *entity, const Level *) {
   return memory->texture;
 }
 
-Entity *createPlayerEntity(Level *, Position start, SDL_Renderer *renderer) {
+Entity *createPlayerEntity(Level *, Position start) {
   Entity *entity = SDL_malloc(sizeof(Entity));
   entity->memory = SDL_malloc(sizeof(Memory));
   entity->position = start;
+  entity->previousPosition = start;
   entity->size.x = entity->size.y = 1;
   entity->cleanup = cleanup;
+  entity->prepare = prepare;
   entity->render = render;
   entity->update = update;
 
@@ -117,11 +130,7 @@ Entity *createPlayerEntity(Level *, Position start, SDL_Renderer *renderer) {
   memory->animation.type = IDLE;
   memory->animation.duration = 0;
   memory->palette = SDL_CreatePalette(5);
-  memory->texture = SDL_CreateTexture(renderer,
-                                      SDL_PIXELFORMAT_RGBA32,
-                                      SDL_TEXTUREACCESS_STREAMING,
-                                      CELL_WIDTH,
-                                      CELL_HEIGHT);
+  memory->texture = nullptr;
 
   SDL_Color colors[5];
   colors[IDLE].r = 255;
@@ -15,6 +15,7 @@
   along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 #include "Engine/Bindings.h"
+#include "Engine/FramePacer.h"
 #include "Engine/Options.h"
 #include "Engine/Pair.h"
 #include "SDL3/SDL_error.h"
@@ -34,23 +35,56 @@
 #include <time.h>
 
 #define STATEMANAGER_CAPACITY 3
+#define OPTIONS_FILE "options.bin"
+#define OPTIONS_TEXT_FILE "options.txt"
+#define DEFAULT_WINDOW_SIZE ((PairInt){640, 480})
 
 typedef struct {
   SDL_Window *window;
   SDL_Renderer *renderer;
 
-  Uint64 lastFrameStartNS;
-  Uint64 lastFrameEndNS;
-  Uint64 targetTickTimeNS;
-  double fps;
-  double frameTime;
+  FramePacer *pacer;
 
   Options *options;
+  // Where the options are saved, or nullptr if there is no such place
+  char *prefPath;
   StateManager *stateManager;
 } AppState;
 
-void setTargetTick(AppState *state, Uint64 FPS) {
-  state->targetTickTimeNS = (long double) SDL_NS_PER_SECOND / (FPS);
+static void setDefaultOptions(Options *options) {
+  Options_SetPairInt(options, OPTION_WINDOWSIZE, DEFAULT_WINDOW_SIZE);
+
+  Bindings *bindings = Options_GetBindings(options);
+  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_UP);
+  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_W);
+  Bindings_SetAlias(bindings, ACTION_MENU_UP, ACTION_MOVE_FORWARD);
+
+  Bindings_Add(bindings, ACTION_MOVE_BACKWARD, SDL_SCANCODE_DOWN);
+  Bindings_Add(bindings, ACTION_MOVE_BACKWARD, SDL_SCANCODE_S);
+  Bindings_SetAlias(bindings, ACTION_MENU_DOWN, ACTION_MOVE_BACKWARD);
+
+  Bindings_Add(bindings, ACTION_MOVE_LEFT, SDL_SCANCODE_LEFT);
+  Bindings_Add(bindings, ACTION_MOVE_LEFT, SDL_SCANCODE_A);
+  Bindings_SetAlias(bindings, ACTION_MENU_LEFT, ACTION_MOVE_LEFT);
+
+  Bindings_Add(bindings, ACTION_MOVE_RIGHT, SDL_SCANCODE_RIGHT);
+  Bindings_Add(bindings, ACTION_MOVE_RIGHT, SDL_SCANCODE_D);
+  Bindings_SetAlias(bindings, ACTION_MENU_RIGHT, ACTION_MOVE_RIGHT);
+
+  Bindings_Add(bindings, ACTION_MENU_OK, SDL_SCANCODE_SPACE);
+  Bindings_Add(bindings, ACTION_MENU_OK, SDL_SCANCODE_RETURN);
+  Bindings_Add(bindings, ACTION_MENU_OK, SDL_SCANCODE_KP_ENTER);
+
+  Bindings_Add(bindings, ACTION_MENU_BACK, SDL_SCANCODE_ESCAPE);
+}
+
+static void onWindowSize(OptionName name, Options *options, void *appstate) {
+  AppState *state = appstate;
+  PairInt size = Options_GetPairInt(options, name, (PairInt){640, 480});
+  SDL_SetWindowSize(state->window, size.first, size.second);
+  SDL_SetWindowPosition(
+      state->window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
+  StateManager_MarkDirty(state->stateManager);
 }
 
 SDL_AppResult SDL_AppInit(void **appstate, int, char **) {
@@ -73,42 +107,35 @@ SDL_AppResult SDL_AppInit(void **appstate, int, char **) {
   }
 
   AppState *state = SDL_malloc(sizeof(AppState));
-  state->lastFrameStartNS = 0;
-  state->lastFrameEndNS = 0;
-  state->fps = 0;
-  state->frameTime = 0;
-  setTargetTick(state, 60);
+  state->pacer = FramePacer_Create(60);
   *appstate = state;
 
+  // The options of the previous run, if any, replace the default ones
   state->options = Options_Create();
-  PairInt windowSize = {640, 480};
-  Options_Set(state->options, OPTION_WINDOWSIZE, &windowSize, sizeof(PairInt));
-
-  Bindings *bindings = Options_GetBindings(state->options);
-  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_UP);
-  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_W);
-  Bindings_SetAlias(bindings, ACTION_MENU_UP, ACTION_MOVE_FORWARD);
-
-  Bindings_Add(bindings, ACTION_MOVE_BACKWARD, SDL_SCANCODE_DOWN);
-  Bindings_Add(bindings, ACTION_MOVE_BACKWARD, SDL_SCANCODE_S);
-  Bindings_SetAlias(bindings, ACTION_MENU_DOWN, ACTION_MOVE_BACKWARD);
-
-  Bindings_Add(bindings, ACTION_MOVE_LEFT, SDL_SCANCODE_LEFT);
-  Bindings_Add(bindings, ACTION_MOVE_LEFT, SDL_SCANCODE_A);
-  Bindings_SetAlias(bindings, ACTION_MENU_LEFT, ACTION_MOVE_LEFT);
-
-  Bindings_Add(bindings, ACTION_MOVE_RIGHT, SDL_SCANCODE_RIGHT);
-  Bindings_Add(bindings, ACTION_MOVE_RIGHT, SDL_SCANCODE_D);
-  Bindings_SetAlias(bindings, ACTION_MENU_RIGHT, ACTION_MOVE_RIGHT);
-
-  Bindings_Add(bindings, ACTION_MENU_OK, SDL_SCANCODE_SPACE);
-  Bindings_Add(bindings, ACTION_MENU_OK, SDL_SCANCODE_RETURN);
-  Bindings_Add(bindings, ACTION_MENU_OK, SDL_SCANCODE_KP_ENTER);
-
-  Bindings_Add(bindings, ACTION_MENU_BACK, SDL_SCANCODE_ESCAPE);
-
-  state->window = SDL_CreateWindow(
-      "Crossing Roads", windowSize.first, windowSize.second, SDL_WINDOW_OPENGL);
+  state->prefPath = SDL_GetPrefPath("gaetanstaquet", "crossing");
+  bool loaded = false;
+  if (state->prefPath != nullptr) {
+    char *path;
+    SDL_asprintf(&path, "%s%s", state->prefPath, OPTIONS_FILE);
+    loaded = SDL_GetPathInfo(path, nullptr) &&
+             Options_Load(state->options, path);
+    SDL_free(path);
+  }
+  if (!loaded) {
+    setDefaultOptions(state->options);
+  } else if (!Options_Has(state->options, OPTION_WINDOWSIZE)) {
+    // Keep the loaded bindings, which the defaults would be added to
+    Options_SetPairInt(state->options, OPTION_WINDOWSIZE, DEFAULT_WINDOW_SIZE);
+  }
+  PairInt windowSize =
+      Options_GetPairInt(state->options, OPTION_WINDOWSIZE, (PairInt){});
+  // The window is created with these options: there is nothing to apply
+  Options_Flush(state->options);
+
+  state->window = SDL_CreateWindow("Crossing Roads",
+                                   windowSize.first,
+                                   windowSize.second,
+                                   SDL_WINDOW_OPENGL);
   if (state->window == nullptr) {
     SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
                     "Couldn't create window: %s",
@@ -124,6 +151,7 @@ SDL_AppResult SDL_AppInit(void **appstate, int, char **) {
                     SDL_GetError());
     return SDL_APP_FAILURE;
   }
+  FramePacer_SetRenderer(state->pacer, state->renderer);
 
   state->stateManager =
       StateManager_Create(STATEMANAGER_CAPACITY, state->window, state->options);
@@ -132,6 +160,7 @@ SDL_AppResult SDL_AppInit(void **appstate, int, char **) {
                     "Couldn't create state manager");
     return SDL_APP_FAILURE;
   }
+  Options_Observe(state->options, OPTION_WINDOWSIZE, onWindowSize, state);
   StateManager_Push(state->stateManager, createStartState());
 
   return SDL_APP_CONTINUE;
@@ -146,35 +175,43 @@ void drawApp(AppState *state) {
   SDL_RenderClear(state->renderer);
 
   StateManager_Render(state->stateManager, state->renderer);
+  FramePacerStats stats;
+  FramePacer_GetStats(state->pacer, &stats);
+  double fps = 0;
+  if (stats.averageFrameNS > 0) {
+    fps = SDL_NS_PER_SECOND * 1. / stats.averageFrameNS;
+  }
   SDL_SetRenderDrawColor(state->renderer, white.r, white.g, white.b, white.a);
-  SDL_RenderDebugTextFormat(
-      state->renderer, 0, 0, "FPS: %f (%fms)", state->fps, state->frameTime);
+  SDL_RenderDebugTextFormat(state->renderer,
+                            0,
+                            0,
+                            "FPS: %f (%fms, target %fms)",
+                            fps,
+                            stats.lastWorkNS * 1. / SDL_NS_PER_MS,
+                            stats.targetNS * 1. / SDL_NS_PER_MS);
 
   SDL_RenderPresent(state->renderer);
 }
 
 void physicsStep(AppState *state, Uint64 deltaNS) {
-  StateManager_Update(state->stateManager, SDL_NS_TO_MS((double)deltaNS));
+  StateManager_Advance(state->stateManager, deltaNS);
 }
 
 SDL_AppResult SDL_AppIterate(void *appstate) {
   AppState *state = appstate;
-  auto startFrame = SDL_GetTicksNS();
+  auto deltaNS = FramePacer_BeginFrame(state->pacer);
 
-  if (startFrame - state->lastFrameStartNS >= state->targetTickTimeNS) {
-    auto deltaNS = startFrame - state->lastFrameEndNS;
-    physicsStep(state, deltaNS);
+  physicsStep(state, deltaNS);
+  // Menus and overlays only change on input: skip identical frames
+  bool presented = StateManager_NeedsRender(state->stateManager);
+  if (presented) {
     drawApp(state);
-
-    auto endFrame = SDL_GetTicksNS();
-    auto frameTime = endFrame - startFrame;
-    auto elapsedSinceLast = endFrame - state->lastFrameEndNS;
-    state->fps = (SDL_NS_PER_SECOND * 1. / elapsedSinceLast);
-    state->frameTime = frameTime * 1. / SDL_NS_PER_MS;
-    state->lastFrameEndNS = endFrame;
-    state->lastFrameStartNS = startFrame;
+    StateManager_ClearDirty(state->stateManager);
   }
 
+  // Sleep until the next frame is due instead of polling the clock
+  FramePacer_EndFrame(state->pacer, presented);
+
   return SDL_APP_CONTINUE;
 }
 
@@ -189,7 +226,22 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
 
 void SDL_AppQuit(void *appstate, SDL_AppResult) {
   AppState *state = appstate;
+  if (state->stateManager->profiler != nullptr) {
+    Profiler_Log(state->stateManager->profiler);
+  }
   StateManager_Free(state->stateManager);
+  StateClass_FreePools();
+  if (state->prefPath != nullptr) {
+    char *path;
+    SDL_asprintf(&path, "%s%s", state->prefPath, OPTIONS_FILE);
+    Options_Save(state->options, path);
+    SDL_free(path);
+    SDL_asprintf(&path, "%s%s", state->prefPath, OPTIONS_TEXT_FILE);
+    Options_Export(state->options, path);
+    SDL_free(path);
+    SDL_free(state->prefPath);
+  }
   Options_Free(state->options);
+  FramePacer_Free(state->pacer);
   SDL_free(state);
 }
@@ -28,11 +28,15 @@ typedef struct {
   unsigned int difficulty;
   bool lost;
   bool won;
+  // Overlays loaded in the background, so that showing them does not stall.
+  // They are nullptr while the manager holds them.
+  State *gameOver;
+  State *victory;
+  // The options observed for the size of the window, once initialized
+  Options *options;
 } Memory;
 
-static Level *setupLevel(unsigned int difficulty, StateManager *manager) {
-  SDL_Rect windowSize = {.x = 0, .y = 0, .w = 0, .h = 0};
-  SDL_GetWindowSize(manager->mainWindow, &(windowSize.w), &(windowSize.h));
+static Level *generateLevel(unsigned int difficulty) {
   double speed = difficulty / 3.;
   if (speed > 2) {
     speed = 2;
@@ -49,22 +53,72 @@ static Level *setupLevel(unsigned int difficulty, StateManager *manager) {
     carLanes = 5;
     riverLanes = 5;
   }
-  return createLevel(speed, carLanes, riverLanes, safeZones, &windowSize, SDL_GetRenderer(manager->mainWindow));
+  return createLevel(speed, carLanes, riverLanes, safeZones);
 }
 
-static void init(void **m, StateManager *manager) {
-  Memory *memory = SDL_malloc(sizeof(Memory));
-  memory->level = setupLevel(1, manager);
+static void prepareForWindow(Level *level, StateManager *manager) {
+  SDL_Rect windowSize = {.x = 0, .y = 0, .w = 0, .h = 0};
+  SDL_GetWindowSize(manager->mainWindow, &(windowSize.w), &(windowSize.h));
+  prepareLevel(level, &windowSize, SDL_GetRenderer(manager->mainWindow));
+}
+
+static Level *setupLevel(unsigned int difficulty, StateManager *manager) {
+  Level *level = generateLevel(difficulty);
+  prepareForWindow(level, manager);
+  return level;
+}
+
+static void load(void **m, StateManager *) {
+  Memory *memory = *m;
+  memory->level = generateLevel(1);
   memory->difficulty = 1;
   memory->lost = false;
   memory->won = false;
-  *m = memory;
+  memory->gameOver = nullptr;
+  memory->victory = nullptr;
+  memory->options = nullptr;
+}
+
+static void onWindowSize(OptionName name, Options *options, void *m) {
+  Memory *memory = m;
+  PairInt size = Options_GetPairInt(options, name, (PairInt){});
+  SDL_Rect windowSize = {.x = 0, .y = 0, .w = size.first, .h = size.second};
+  layoutLevel(memory->level, &windowSize);
+}
+
+static void init(void **m, StateManager *manager) {
+  Memory *memory = *m;
+  prepareForWindow(memory->level, manager);
+  memory->options = manager->options;
+  Options_Observe(memory->options, OPTION_WINDOWSIZE, onWindowSize, memory);
+
+  memory->gameOver = createGameOverState(manager);
+  StateManager_Preload(manager, memory->gameOver);
+  memory->victory = createVictoryState(manager);
+  StateManager_Preload(manager, memory->victory);
 }
 
 static void destroy(void *m) {
   Memory *memory = m;
+  if (memory->options != nullptr) {
+    Options_Unobserve(
+        memory->options, OPTION_WINDOWSIZE, onWindowSize, memory);
+  }
   freeLevel(memory->level);
-  SDL_free(m);
+  State_Free(memory->gameOver);
+  State_Free(memory->victory);
+}
+
+static void showOverlay(State **overlay,
+                        State *(*create)(StateManager *),
+                        StateManager *manager) {
+  // The overlays are kept alive by the manager once popped
+  if (*overlay == nullptr) {
+    *overlay = create(manager);
+  }
+  if (StateManager_Push(manager, *overlay) == STATEMANAGER_OK) {
+    *overlay = nullptr;
+  }
 }
 
 static bool update(void *m, Uint64 deltaMS, StateManager *manager) {
@@ -86,39 +140,36 @@ static bool update(void *m, Uint64 deltaMS, StateManager *manager) {
       break;
     case LOST:
       memory->lost = true;
-      StateManager_Push(manager, createGameOverState());
+      showOverlay(&memory->gameOver, createGameOverState, manager);
       break;
     case WON:
       memory->won = true;
-      StateManager_Push(manager, createVictoryState());
+      showOverlay(&memory->victory, createVictoryState, manager);
       break;
     }
   }
   return false;
 }
 
-static void render(void *m, SDL_Renderer *renderer) {
+static void render(void *m, SDL_Renderer *renderer, float alpha) {
   Memory *memory = m;
-  renderLevel(memory->level, renderer);
+  renderLevel(memory->level, renderer, alpha);
 }
 
 static bool processEvent(void *m, SDL_Event *event, StateManager *manager) {
   Memory *memory = m;
   Bindings *bindings = Options_GetBindings(manager->options);
   if (event->type == SDL_EVENT_KEY_DOWN) {
-    if (Bindings_Matches(bindings, ACTION_MOVE_FORWARD, event->key.scancode)) {
+    Uint64 actions = Bindings_ActionsFor(bindings, event->key.scancode);
+    if (actions & BINDINGS_ACTION(ACTION_MOVE_FORWARD)) {
       moveEventLevel(memory->level, UP);
-    } else if (Bindings_Matches(
-                   bindings, ACTION_MOVE_BACKWARD, event->key.scancode)) {
+    } else if (actions & BINDINGS_ACTION(ACTION_MOVE_BACKWARD)) {
       moveEventLevel(memory->level, DOWN);
-    } else if (Bindings_Matches(
-                   bindings, ACTION_MOVE_LEFT, event->key.scancode)) {
+    } else if (actions & BINDINGS_ACTION(ACTION_MOVE_LEFT)) {
       moveEventLevel(memory->level, LEFT);
-    } else if (Bindings_Matches(
-                   bindings, ACTION_MOVE_RIGHT, event->key.scancode)) {
+    } else if (actions & BINDINGS_ACTION(ACTION_MOVE_RIGHT)) {
       moveEventLevel(memory->level, RIGHT);
-    } else if (Bindings_Matches(
-                   bindings, ACTION_MENU_BACK, event->key.scancode)) {
+    } else if (actions & BINDINGS_ACTION(ACTION_MENU_BACK)) {
       StateManager_Pop(manager);
       StateManager_Push(manager, createStartState());
     }
@@ -126,12 +177,18 @@ static bool processEvent(void *m, SDL_Event *event, StateManager *manager) {
   return false;
 }
 
+static const StateClass gameClass = {
+    .name = "Game",
+    .load = load,
+    .init = init,
+    .destroy = destroy,
+    .update = update,
+    .render = render,
+    .processEvent = processEvent,
+    .events = EVENTMASK(EVENT_CATEGORY_KEY_DOWN),
+    .memorySize = sizeof(Memory),
+};
+
 State *createGameState() {
-  State *state = State_Create();
-  State_SetInit(state, init);
-  State_SetDestroy(state, destroy);
-  State_SetUpdate(state, update);
-  State_SetRender(state, render);
-  State_SetProcessEvent(state, processEvent);
-  return state;
+  return State_Create(&gameClass);
 }
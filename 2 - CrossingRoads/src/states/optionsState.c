@@ -30,10 +30,12 @@ typedef enum {
 typedef struct Memory Memory;
 
 typedef struct {
+  SDL_Surface *surface;
   SDL_Texture *texture;
   void (*callback)(Memory *, StateManager *);
 
   struct {
+    SDL_Surface **surfaces;
     SDL_Texture **possibilities;
     unsigned int selection;
     unsigned int size;
@@ -43,48 +45,45 @@ typedef struct {
 struct Memory {
   unsigned int selection;
   SDL_Color unselectedColor, selectedColor;
-  TTF_Font *font;
 
   Text *texts;
   unsigned int size;
 };
 
+// The window follows the option, see main.c
 static void onApply(Memory *memory, StateManager *manager) {
+  PairInt size = {640, 480};
   switch (memory->texts[0].possibilities.selection) {
   case SIZE_640x480:
-    SDL_SetWindowSize(manager->mainWindow, 640, 480);
+    size = (PairInt){640, 480};
     break;
   case SIZE_800x600:
-    SDL_SetWindowSize(manager->mainWindow, 800, 600);
+    size = (PairInt){800, 600};
     break;
   case SIZE_1600x900:
-    SDL_SetWindowSize(manager->mainWindow, 1600, 900);
+    size = (PairInt){1600, 900};
     break;
   }
-  SDL_SetWindowPosition(
-      manager->mainWindow, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
+  Options_SetPairInt(manager->options, OPTION_WINDOWSIZE, size);
 }
 
 static void onExit(Memory *, StateManager *manager) {
   StateManager_Pop(manager);
 }
 
-static SDL_Texture *createTextureText(SDL_Renderer *renderer,
-                                      TTF_Font *font,
-                                      const char *string,
-                                      SDL_Color color) {
-  SDL_Surface *surface = TTF_RenderText_Blended(font, string, 0, color);
-  SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
-  SDL_DestroySurface(surface);
+static SDL_Texture *uploadText(SDL_Renderer *renderer, SDL_Surface **surface) {
+  SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, *surface);
+  SDL_DestroySurface(*surface);
+  *surface = nullptr;
   return texture;
 }
 
-static void init(void **memory, StateManager *manager) {
-  SDL_Renderer *renderer = SDL_GetRenderer(manager->mainWindow);
-  Memory *m = SDL_malloc(sizeof(Memory));
+static void load(void **memory, StateManager *) {
+  Memory *m = *memory;
   m->selection = 0;
-  m->font = TTF_OpenFont("resources/freefont-ttf/sfd/FreeSerif.ttf", 32);
-  if (m->font == nullptr) {
+  TTF_Font *font =
+      TTF_OpenFont("resources/freefont-ttf/sfd/FreeSerif.ttf", 32);
+  if (font == nullptr) {
     SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
                  "Impossible to load font file: %s",
                  SDL_GetError());
@@ -99,58 +98,79 @@ static void init(void **memory, StateManager *manager) {
   m->size = 3;
   m->texts = SDL_calloc(m->size, sizeof(Text));
 
-  m->texts[0].texture =
-      createTextureText(renderer, m->font, "Window size", white);
+  m->texts[0].surface = TTF_RenderText_Blended(font, "Window size", 0, white);
   m->texts[0].callback = nullptr;
   m->texts[0].possibilities.selection = 0;
   m->texts[0].possibilities.size = 3;
+  m->texts[0].possibilities.surfaces =
+      SDL_calloc(m->texts[0].possibilities.size, sizeof(SDL_Surface *));
   m->texts[0].possibilities.possibilities =
       SDL_calloc(m->texts[0].possibilities.size, sizeof(SDL_Texture *));
-  m->texts[0].possibilities.possibilities[SIZE_640x480] =
-      createTextureText(renderer, m->font, "640x480", white);
-  m->texts[0].possibilities.possibilities[SIZE_800x600] =
-      createTextureText(renderer, m->font, "800x600", white);
-  m->texts[0].possibilities.possibilities[SIZE_1600x900] =
-      createTextureText(renderer, m->font, "1600x900", white);
-
-  m->texts[1].texture = createTextureText(renderer, m->font, "Apply", white);
+  m->texts[0].possibilities.surfaces[SIZE_640x480] =
+      TTF_RenderText_Blended(font, "640x480", 0, white);
+  m->texts[0].possibilities.surfaces[SIZE_800x600] =
+      TTF_RenderText_Blended(font, "800x600", 0, white);
+  m->texts[0].possibilities.surfaces[SIZE_1600x900] =
+      TTF_RenderText_Blended(font, "1600x900", 0, white);
+
+  m->texts[1].surface = TTF_RenderText_Blended(font, "Apply", 0, white);
   m->texts[1].callback = onApply;
   m->texts[1].possibilities.selection = 0;
+  m->texts[1].possibilities.surfaces = nullptr;
   m->texts[1].possibilities.possibilities = nullptr;
 
-  m->texts[2].texture = createTextureText(renderer, m->font, "Exit", white);
+  m->texts[2].surface = TTF_RenderText_Blended(font, "Exit", 0, white);
   m->texts[2].callback = onExit;
   m->texts[2].possibilities.selection = 0;
+  m->texts[2].possibilities.surfaces = nullptr;
   m->texts[2].possibilities.possibilities = nullptr;
+  TTF_CloseFont(font);
+}
 
-  *memory = m;
+static void init(void **memory, StateManager *manager) {
+  SDL_Renderer *renderer = SDL_GetRenderer(manager->mainWindow);
+  Memory *m = *memory;
+
+  for (unsigned int i = 0; i < m->size; i++) {
+    m->texts[i].texture = uploadText(renderer, &m->texts[i].surface);
+    for (unsigned int j = 0; j < m->texts[i].possibilities.size; j++) {
+      m->texts[i].possibilities.possibilities[j] =
+          uploadText(renderer, &m->texts[i].possibilities.surfaces[j]);
+    }
+  }
 }
 
 static void destroy(void *memory) {
   Memory *m = memory;
   for (unsigned int i = 0; i < m->size; i++) {
-    SDL_DestroyTexture(m->texts[i].texture);
+    SDL_DestroySurface(m->texts[i].surface);
+    if (m->texts[i].texture != nullptr) {
+      SDL_DestroyTexture(m->texts[i].texture);
+    }
 
+    SDL_Surface **surfaces = m->texts[i].possibilities.surfaces;
     SDL_Texture **possibilities = m->texts[i].possibilities.possibilities;
     if (possibilities != nullptr) {
       for (unsigned int j = 0; j < m->texts[i].possibilities.size; j++) {
-        SDL_DestroyTexture(possibilities[j]);
+        SDL_DestroySurface(surfaces[j]);
+        if (possibilities[j] != nullptr) {
+          SDL_DestroyTexture(possibilities[j]);
+        }
       }
+      SDL_free(surfaces);
       SDL_free(possibilities);
     }
   }
   SDL_free(m->texts);
-  TTF_CloseFont(m->font);
-  SDL_free(memory);
 }
 
-static void render(void *memory, SDL_Renderer *renderer) {
+static void render(void *memory, SDL_Renderer *renderer, float) {
   const Memory *m = memory;
+  int w = 0, h = 0;
+  SDL_GetRenderOutputSize(renderer, &w, &h);
 
   for (unsigned int i = 0; i < m->size; i++) {
     SDL_Texture *texture = m->texts[i].texture;
-    int w = 0, h = 0;
-    SDL_GetRenderOutputSize(renderer, &w, &h);
     SDL_FRect dst;
     SDL_GetTextureSize(texture, &dst.w, &dst.h);
     dst.x = (w - dst.w) / 2;
@@ -197,39 +217,47 @@ processEvent(void *memory, SDL_Event *event, StateManager *manager) {
   Memory *m = memory;
   const Bindings *bindings = Options_GetBindings(manager->options);
   unsigned int current = m->selection;
+  unsigned int possibility = m->texts[current].possibilities.selection;
 
   if (event->type == SDL_EVENT_KEY_DOWN) {
-    if (Bindings_Matches(bindings, ACTION_MENU_DOWN, event->key.scancode) &&
+    Uint64 actions = Bindings_ActionsFor(bindings, event->key.scancode);
+    if ((actions & BINDINGS_ACTION(ACTION_MENU_DOWN)) &&
         current + 1 < m->size) {
       m->selection++;
-    } else if (Bindings_Matches(
-                   bindings, ACTION_MENU_UP, event->key.scancode) &&
-               current > 0) {
+    } else if ((actions & BINDINGS_ACTION(ACTION_MENU_UP)) && current > 0) {
       m->selection--;
-    } else if (Bindings_Matches(
-                   bindings, ACTION_MENU_LEFT, event->key.scancode) &&
+    } else if ((actions & BINDINGS_ACTION(ACTION_MENU_LEFT)) &&
                m->texts[current].possibilities.selection > 0) {
       m->texts[current].possibilities.selection--;
-    } else if (Bindings_Matches(
-                   bindings, ACTION_MENU_RIGHT, event->key.scancode) &&
+    } else if ((actions & BINDINGS_ACTION(ACTION_MENU_RIGHT)) &&
                m->texts[current].possibilities.selection + 1 <
                    m->texts[current].possibilities.size) {
       m->texts[current].possibilities.selection++;
-    } else if (Bindings_Matches(
-                   bindings, ACTION_MENU_OK, event->key.scancode)) {
+    } else if (actions & BINDINGS_ACTION(ACTION_MENU_OK)) {
       if (m->texts[m->selection].callback != nullptr) {
         m->texts[m->selection].callback(m, manager);
       }
     }
   }
+  if (m->selection != current ||
+      m->texts[current].possibilities.selection != possibility) {
+    StateManager_MarkDirty(manager);
+  }
   return false;
 }
 
+static const StateClass optionsClass = {
+    .name = "Options",
+    .load = load,
+    .init = init,
+    .destroy = destroy,
+    .render = render,
+    .processEvent = processEvent,
+    .events = EVENTMASK(EVENT_CATEGORY_KEY_DOWN),
+    .renderOnDemand = true,
+    .memorySize = sizeof(Memory),
+};
+
 State *createOptionsState() {
-  State *state = State_Create();
-  State_SetInit(state, init);
-  State_SetDestroy(state, destroy);
-  State_SetRender(state, render);
-  State_SetProcessEvent(state, processEvent);
-  return state;
+  return State_Create(&optionsClass);
 }
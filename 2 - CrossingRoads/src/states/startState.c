@@ -25,25 +25,35 @@ typedef struct Memory Memory;
 struct Memory {
   unsigned int selection;
   SDL_Color unselectedColor, selectedColor;
-  TTF_Font *font;
 
   struct {
+    SDL_Surface **surfaces;
     SDL_Texture **textures;
-    void (**callbacks)(StateManager *);
+    void (**callbacks)(Memory *, StateManager *);
     unsigned int size;
   } texts;
+
+  // States loaded in the background while the menu is shown
+  State *game;
+  State *options;
 };
 
-static void onStart(StateManager *manager) {
+static void onStart(Memory *memory, StateManager *manager) {
   StateManager_Pop(manager);
-  StateManager_Push(manager, createGameState());
+  if (StateManager_Push(manager, memory->game) == STATEMANAGER_OK) {
+    // The manager now owns the game state
+    memory->game = nullptr;
+  }
 }
 
-static void onOptions(StateManager *manager) {
-  StateManager_Push(manager, createOptionsState());
+static void onOptions(Memory *memory, StateManager *manager) {
+  if (StateManager_Push(manager, memory->options) == STATEMANAGER_OK) {
+    memory->options = createOptionsState();
+    StateManager_Preload(manager, memory->options);
+  }
 }
 
-static void onExit(StateManager *) {
+static void onExit(Memory *, StateManager *) {
   SDL_Event quitEvent;
   SDL_zero(quitEvent);
   quitEvent.type = SDL_EVENT_QUIT;
@@ -51,12 +61,12 @@ static void onExit(StateManager *) {
   SDL_PushEvent(&quitEvent); // SDL copies the event
 }
 
-static void init(void **memory, StateManager *manager) {
-  SDL_Renderer *renderer = SDL_GetRenderer(manager->mainWindow);
-  Memory *m = SDL_malloc(sizeof(Memory));
+static void load(void **memory, StateManager *) {
+  Memory *m = *memory;
   m->selection = 0;
-  m->font = TTF_OpenFont("resources/freefont-ttf/sfd/FreeSerif.ttf", 32);
-  if (m->font == nullptr) {
+  TTF_Font *font =
+      TTF_OpenFont("resources/freefont-ttf/sfd/FreeSerif.ttf", 32);
+  if (font == nullptr) {
     SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
                  "Impossible to load font file: %s",
                  SDL_GetError());
@@ -69,46 +79,62 @@ static void init(void **memory, StateManager *manager) {
   m->unselectedColor = white;
 
   m->texts.size = 3;
+  m->texts.surfaces = SDL_calloc(m->texts.size, sizeof(SDL_Surface *));
   m->texts.textures = SDL_calloc(m->texts.size, sizeof(SDL_Texture *));
   m->texts.callbacks = SDL_calloc(m->texts.size, sizeof(void (*)()));
-  SDL_Surface *surface = TTF_RenderText_Blended(m->font, "Start", 0, white);
-  m->texts.textures[0] = SDL_CreateTextureFromSurface(renderer, surface);
-  SDL_DestroySurface(surface);
+  m->texts.surfaces[0] = TTF_RenderText_Blended(font, "Start", 0, white);
   m->texts.callbacks[0] = onStart;
 
-  surface = TTF_RenderText_Blended(m->font, "Options", 0, white);
-  m->texts.textures[1] = SDL_CreateTextureFromSurface(renderer, surface);
-  SDL_DestroySurface(surface);
+  m->texts.surfaces[1] = TTF_RenderText_Blended(font, "Options", 0, white);
   m->texts.callbacks[1] = onOptions;
 
-  surface = TTF_RenderText_Blended(m->font, "Exit", 0, white);
-  m->texts.textures[2] = SDL_CreateTextureFromSurface(renderer, surface);
-  SDL_DestroySurface(surface);
+  m->texts.surfaces[2] = TTF_RenderText_Blended(font, "Exit", 0, white);
   m->texts.callbacks[2] = onExit;
+  TTF_CloseFont(font);
+
+  m->game = nullptr;
+  m->options = nullptr;
+}
+
+static void init(void **memory, StateManager *manager) {
+  SDL_Renderer *renderer = SDL_GetRenderer(manager->mainWindow);
+  Memory *m = *memory;
+
+  for (unsigned int i = 0; i < m->texts.size; i++) {
+    m->texts.textures[i] =
+        SDL_CreateTextureFromSurface(renderer, m->texts.surfaces[i]);
+    SDL_DestroySurface(m->texts.surfaces[i]);
+    m->texts.surfaces[i] = nullptr;
+  }
 
-  *memory = m;
+  m->game = createGameState();
+  StateManager_Preload(manager, m->game);
+  m->options = createOptionsState();
+  StateManager_Preload(manager, m->options);
 }
 
 static void destroy(void *memory) {
   Memory *m = memory;
   for (unsigned int i = 0; i < m->texts.size; i++) {
+    SDL_DestroySurface(m->texts.surfaces[i]);
     if (m->texts.textures[i] != nullptr) {
       SDL_DestroyTexture(m->texts.textures[i]);
     }
   }
   SDL_free(m->texts.callbacks);
   SDL_free(m->texts.textures);
-  TTF_CloseFont(m->font);
-  SDL_free(memory);
+  SDL_free(m->texts.surfaces);
+  State_Free(m->game);
+  State_Free(m->options);
 }
 
-static void render(void *memory, SDL_Renderer *renderer) {
+static void render(void *memory, SDL_Renderer *renderer, float) {
   const Memory *m = memory;
+  int w = 0, h = 0;
+  SDL_GetRenderOutputSize(renderer, &w, &h);
 
   for (unsigned int i = 0; i < m->texts.size; i++) {
     SDL_Texture *texture = m->texts.textures[i];
-    int w = 0, h = 0;
-    SDL_GetRenderOutputSize(renderer, &w, &h);
     SDL_FRect dst;
     SDL_GetTextureSize(texture, &dst.w, &dst.h);
     dst.x = (w - dst.w) / 2;
@@ -131,30 +157,40 @@ static bool
 processEvent(void *memory, SDL_Event *event, StateManager *manager) {
   Memory *m = memory;
   const Bindings *bindings = Options_GetBindings(manager->options);
+  unsigned int previous = m->selection;
 
   if (event->type == SDL_EVENT_KEY_DOWN) {
-    if (Bindings_Matches(bindings, ACTION_MENU_DOWN, event->key.scancode) &&
+    Uint64 actions = Bindings_ActionsFor(bindings, event->key.scancode);
+    if ((actions & BINDINGS_ACTION(ACTION_MENU_DOWN)) &&
         m->selection + 1 < m->texts.size) {
       m->selection++;
-    } else if (Bindings_Matches(
-                   bindings, ACTION_MENU_UP, event->key.scancode) &&
+    } else if ((actions & BINDINGS_ACTION(ACTION_MENU_UP)) &&
                m->selection > 0) {
       m->selection--;
-    } else if (Bindings_Matches(
-                   bindings, ACTION_MENU_OK, event->key.scancode)) {
+    } else if (actions & BINDINGS_ACTION(ACTION_MENU_OK)) {
       if (m->texts.callbacks[m->selection] != nullptr) {
-        m->texts.callbacks[m->selection](manager);
+        m->texts.callbacks[m->selection](m, manager);
       }
     }
   }
+  if (m->selection != previous) {
+    StateManager_MarkDirty(manager);
+  }
   return false;
 }
 
+static const StateClass startClass = {
+    .name = "Start",
+    .load = load,
+    .init = init,
+    .destroy = destroy,
+    .render = render,
+    .processEvent = processEvent,
+    .events = EVENTMASK(EVENT_CATEGORY_KEY_DOWN),
+    .renderOnDemand = true,
+    .memorySize = sizeof(Memory),
+};
+
 State *createStartState() {
-  State *state = State_Create();
-  State_SetInit(state, init);
-  State_SetDestroy(state, destroy);
-  State_SetRender(state, render);
-  State_SetProcessEvent(state, processEvent);
-  return state;
+  return State_Create(&startClass);
 }
@@ -23,46 +23,62 @@
 typedef struct Memory Memory;
 
 struct Memory {
-  TTF_Font *font;
+  SDL_Surface *victorySurface;
+  SDL_Surface *instructionSurface;
   SDL_Texture *victory;
   SDL_Texture *instruction;
 };
 
-static void init(void **memory, StateManager *manager) {
-  SDL_Renderer *renderer = SDL_GetRenderer(manager->mainWindow);
-  Memory *m = SDL_malloc(sizeof(Memory));
-  m->font = TTF_OpenFont("resources/freefont-ttf/sfd/FreeSerif.ttf", 32);
-  if (m->font == nullptr) {
+static void load(void **memory, StateManager *) {
+  Memory *m = *memory;
+  TTF_Font *font =
+      TTF_OpenFont("resources/freefont-ttf/sfd/FreeSerif.ttf", 32);
+  if (font == nullptr) {
     SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
                  "Impossible to load font file: %s",
                  SDL_GetError());
   }
   SDL_Color white = {255, 255, 255, SDL_ALPHA_OPAQUE};
 
-  SDL_Surface *surface = TTF_RenderText_Blended(m->font, "Level finished!", 0, white);
-  m->victory = SDL_CreateTextureFromSurface(renderer, surface);
-  SDL_DestroySurface(surface);
+  m->victorySurface = TTF_RenderText_Blended(font, "Level finished!", 0, white);
+  m->instructionSurface =
+      TTF_RenderText_Blended(font, "Press SPACE to play next level", 0, white);
+  m->victory = nullptr;
+  m->instruction = nullptr;
+  TTF_CloseFont(font);
+}
+
+static void init(void **memory, StateManager *manager) {
+  SDL_Renderer *renderer = SDL_GetRenderer(manager->mainWindow);
+  Memory *m = *memory;
 
-  surface = TTF_RenderText_Blended(m->font, "Press SPACE to play next level", 0, white);
-  m->instruction = SDL_CreateTextureFromSurface(renderer, surface);
-  SDL_DestroySurface(surface);
+  m->victory = SDL_CreateTextureFromSurface(renderer, m->victorySurface);
+  SDL_DestroySurface(m->victorySurface);
+  m->victorySurface = nullptr;
 
-  *memory = m;
+  m->instruction =
+      SDL_CreateTextureFromSurface(renderer, m->instructionSurface);
+  SDL_DestroySurface(m->instructionSurface);
+  m->instructionSurface = nullptr;
 }
 
 static void destroy(void *memory) {
   Memory *m = memory;
-  SDL_DestroyTexture(m->victory);
-  SDL_DestroyTexture(m->instruction);
-  TTF_CloseFont(m->font);
-  SDL_free(memory);
+  SDL_DestroySurface(m->victorySurface);
+  SDL_DestroySurface(m->instructionSurface);
+  if (m->victory != nullptr) {
+    SDL_DestroyTexture(m->victory);
+  }
+  if (m->instruction != nullptr) {
+    SDL_DestroyTexture(m->instruction);
+  }
 }
 
 static bool isTransparent(const void *) {
   return true;
 }
 
-static void render(void *memory, SDL_Renderer *renderer) {
+static void render(void *memory, SDL_Renderer *renderer, float) {
   const Memory *m = memory;
 
   int w = 0, h = 0;
@@ -91,12 +107,21 @@ static bool processEvent(void *, SDL_Event *event, StateManager *manager) {
   return false;
 }
 
-State *createVictoryState() {
-  State *state = State_Create();
-  State_SetInit(state, init);
-  State_SetDestroy(state, destroy);
-  State_SetIsTransparent(state, isTransparent);
-  State_SetRender(state, render);
-  State_SetProcessEvent(state, processEvent);
-  return state;
+static const StateClass victoryClass = {
+    .name = "Victory",
+    .load = load,
+    .init = init,
+    .destroy = destroy,
+    .isTransparent = isTransparent,
+    .render = render,
+    .processEvent = processEvent,
+    .events = EVENTMASK(EVENT_CATEGORY_KEY_DOWN),
+    .cacheBelow = true,
+    .renderOnDemand = true,
+    .memorySize = sizeof(Memory),
+    .keepAlive = true,
+};
+
+State *createVictoryState(StateManager *manager) {
+  return StateManager_Acquire(manager, &victoryClass);
 }
@@ -18,7 +18,6 @@
 #pragma once
 
 #include "SDL3/SDL.h"
-#include <glib.h>
 
 /**
  * The predefined actions.
@@ -40,6 +39,24 @@ typedef enum {
   ACTION_CUSTOM
 } Action;
 
+/**
+ * How many actions can be bound, including the predefined ones.
+ */
+#define BINDINGS_MAX_ACTIONS 64
+/**
+ * How many scancodes can be bound to one action.
+ */
+#define BINDINGS_MAX_SCANCODES 8
+/**
+ * How many aliases one action can have.
+ */
+#define BINDINGS_MAX_ALIASES 8
+
+/**
+ * The bit of an action in the result of \ref Bindings_ActionsFor.
+ */
+#define BINDINGS_ACTION(action) ((Uint64)1 << (action))
+
 /**
  * The Bindings struct handles the bindings between an \ref Action and a
  * SDL_Scancode.
@@ -57,15 +74,75 @@ typedef enum {
  * a, b)</code> is called, then any scancode that matches <code>b</code> will
  * also match <code>a</code>. Use \ref Bindings_SetAlias, \ref
  * Bindings_AddAlias, \ref Bindings_RemoveAlias and \ref Bindings_ClearAlias to
- * manipulate the aliases.
+ * manipulate the aliases. Aliases are followed transitively: if <code>b</code>
+ * is itself an alias of <code>c</code>, the scancodes of <code>c</code> match
+ * <code>a</code> too. Cycles of aliases are allowed.
  *
  * \ref Bindings_Get does not return, nor "expand" the aliases, i.e., the
- * function only returns the proper key bindings.
+ * function only returns the proper key bindings. \ref Bindings_GetInto does
+ * the same into a buffer of the caller, without allocating. To go through every
+ * scancode that matches an action, aliases included, use \ref
+ * Bindings_Iterate and \ref Bindings_Next, which do not allocate either.
+ *
+ * Bindings are edited rarely but matched on every key event. Thus, the
+ * bindings are compiled into a table giving, for each scancode, the set of
+ * actions it matches, aliases included. The table is rebuilt by the first
+ * lookup after an edit. Matching an action is then a single lookup, however
+ * deep its aliases are. \ref Bindings_ActionsFor returns the whole entry of a
+ * scancode, so that a state can find every action triggered by a key at once.
+ *
+ * The bindings are stored inline, in one block indexed by the actions, so
+ * editing them never allocates. The counterpart is that the number of actions,
+ * of scancodes per action and of aliases per action are bounded by \ref
+ * BINDINGS_MAX_ACTIONS, \ref BINDINGS_MAX_SCANCODES and \ref
+ * BINDINGS_MAX_ALIASES. Edits beyond these bounds are logged and ignored.
+ * Binding the same scancode twice to an action has no effect.
+ *
+ * \ref Bindings_Write and \ref Bindings_Read save and restore the bindings in
+ * a compact binary form, which is meant to be embedded in a larger file (see
+ * \ref Options_Save). Reading replaces every binding, and leaves the bindings
+ * untouched if the data is invalid. \ref Bindings_Export writes them as text
+ * instead, one action per line: its quoted scancode names, then the actions it
+ * aliases. The text form cannot be read back.
  *
  * \warning Controllers and mouse controls are not supported.
  */
 typedef struct Bindings Bindings;
 
+/**
+ * Goes through the scancodes matching an action, aliases included.
+ *
+ * Initialize it with \ref Bindings_Iterate, then call \ref Bindings_Next
+ * until it returns <code>false</code>. Each scancode is given once, the ones
+ * bound to the action itself first. The bindings must not be edited during
+ * the iteration.
+ *
+ * The members are private.
+ */
+typedef struct {
+  /**
+   * The bindings being iterated, or <code>nullptr</code> once the iteration is
+   * over.
+   */
+  const Bindings *bindings;
+  /**
+   * The action whose scancodes are being given.
+   */
+  Action current;
+  /**
+   * The index of the next scancode of the current action.
+   */
+  unsigned int index;
+  /**
+   * The aliased actions that remain to be visited.
+   */
+  Uint64 remaining;
+  /**
+   * The actions whose scancodes were all given.
+   */
+  Uint64 visited;
+} BindingsIterator;
+
 Bindings *Bindings_Create();
 void Bindings_Free(Bindings *bindings);
 void Bindings_Clear(Bindings *bindings, Action action);
@@ -84,3 +161,15 @@ void Bindings_Get(const Bindings *bindings,
 bool Bindings_Matches(const Bindings *bindings,
                       Action action,
                       SDL_Scancode scancode);
+size_t Bindings_GetInto(const Bindings *bindings,
+                        Action action,
+                        SDL_Scancode *scancodes,
+                        size_t capacity);
+Uint64 Bindings_ActionsFor(const Bindings *bindings, SDL_Scancode scancode);
+void Bindings_Iterate(const Bindings *bindings,
+                      Action action,
+                      BindingsIterator *iterator);
+bool Bindings_Next(BindingsIterator *iterator, SDL_Scancode *scancode);
+bool Bindings_Write(const Bindings *bindings, SDL_IOStream *stream);
+bool Bindings_Read(Bindings *bindings, SDL_IOStream *stream);
+bool Bindings_Export(const Bindings *bindings, SDL_IOStream *stream);
@@ -0,0 +1,136 @@
+/* Small game engine in C.
+  Copyright (C) 2025 Gaëtan Staquet <gaetan.staquet@gmail.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "SDL3/SDL.h"
+
+/**
+ * With \ref FRAMEPACER_LOW_LATENCY, how long before the deadline the pacer
+ * stops sleeping and starts spinning, in nanoseconds.
+ */
+#define FRAMEPACER_SPIN_MARGIN_NS (2 * SDL_NS_PER_MS)
+
+/**
+ * How the frame pacer waits for the next frame.
+ *
+ * The modes are sorted from the most power-efficient to the most precise.
+ */
+typedef enum {
+  /**
+   * Sleep until the deadline. The wake-up may be late by the granularity of
+   * the system scheduler, but the CPU is idle the whole time.
+   */
+  FRAMEPACER_POWER_SAVING = 0,
+  /**
+   * Use SDL_DelayPrecise, which sleeps then spins for a short while.
+   */
+  FRAMEPACER_BALANCED,
+  /**
+   * Sleep until \ref FRAMEPACER_SPIN_MARGIN_NS before the deadline, then spin.
+   * The frames start right on time, at the cost of a busy CPU during the
+   * margin.
+   */
+  FRAMEPACER_LOW_LATENCY,
+} FramePacerMode;
+
+/**
+ * The timings measured by a frame pacer.
+ */
+typedef struct {
+  /**
+   * The duration a frame should last, in nanoseconds, or 0 if uncapped.
+   */
+  Uint64 targetNS;
+  /**
+   * How long the previous frame actually lasted, from its start to the start
+   * of the current frame, in nanoseconds.
+   */
+  Uint64 lastFrameNS;
+  /**
+   * How long the previous frame worked before waiting, in nanoseconds.
+   */
+  Uint64 lastWorkNS;
+  /**
+   * The exponential moving average of the frame durations, in nanoseconds.
+   */
+  Uint64 averageFrameNS;
+  /**
+   * How many frames worked longer than the target.
+   */
+  unsigned int lateFrames;
+  /**
+   * How many frames have started.
+   */
+  unsigned int frames;
+} FramePacerStats;
+
+/**
+ * The clock a frame pacer reads and sleeps with.
+ *
+ * The default clock is SDL's. Replacing it lets the pacing be checked without
+ * depending on the scheduler of the machine.
+ */
+typedef struct {
+  /**
+   * Returns the current time, in nanoseconds.
+   */
+  Uint64 (*now)(void *userdata);
+  /**
+   * Sleeps for the given duration, in nanoseconds. It may be late.
+   */
+  void (*delay)(void *userdata, Uint64 ns);
+  /**
+   * Waits for the given duration, in nanoseconds, as precisely as possible.
+   */
+  void (*delayPrecise)(void *userdata, Uint64 ns);
+  /**
+   * The pointer given to the functions of the clock.
+   */
+  void *userdata;
+} FramePacerClock;
+
+/**
+ * The FramePacer struct spaces the frames of the application.
+ *
+ * Call \ref FramePacer_BeginFrame at the start of each iteration, which returns
+ * the time elapsed since the previous one, and \ref FramePacer_EndFrame at the
+ * end, which sleeps until the next frame is due instead of letting the
+ * application poll the clock.
+ *
+ * When the renderer waits for the vertical synchronization, presenting a frame
+ * blocks until a refresh of the display: give the renderer to \ref
+ * FramePacer_SetRenderer, or the refresh period to \ref
+ * FramePacer_SetVSyncInterval. Present before calling \ref FramePacer_EndFrame,
+ * and tell it whether the frame presented anything. After a presentation, the
+ * pacer sleeps until one refresh before the first one that meets the target,
+ * so that the next presentation lands on it. When nothing was presented, the
+ * pacer sleeps until the target.
+ *
+ * \sa FramePacerMode for the trade-off between power and latency.
+ */
+typedef struct FramePacer FramePacer;
+
+FramePacer *FramePacer_Create(unsigned int targetFPS);
+void FramePacer_Free(FramePacer *pacer);
+void FramePacer_SetTargetFPS(FramePacer *pacer, unsigned int targetFPS);
+void FramePacer_SetMode(FramePacer *pacer, FramePacerMode mode);
+void FramePacer_SetVSyncInterval(FramePacer *pacer, Uint64 intervalNS);
+void FramePacer_SetRenderer(FramePacer *pacer, SDL_Renderer *renderer);
+void FramePacer_SetClock(FramePacer *pacer, const FramePacerClock *clock);
+Uint64 FramePacer_BeginFrame(FramePacer *pacer);
+void FramePacer_EndFrame(FramePacer *pacer, bool presented);
+void FramePacer_GetStats(const FramePacer *pacer, FramePacerStats *stats);
@@ -0,0 +1,55 @@
+/* Small game engine in C.
+  Copyright (C) 2025 Gaëtan Staquet <gaetan.staquet@gmail.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "Engine/Bindings.h"
+#include "SDL3/SDL.h"
+
+/**
+ * The Input struct tracks the state of the actions from one sample of the
+ * keyboard to the next.
+ *
+ * Events tell when a key goes down, but continuous controls need to know
+ * whether an action is held right now. Once per tick, \ref Input_Update reads
+ * the keyboard state and looks up each pressed scancode in the bindings given
+ * to \ref Input_Create. The result is stored as bitmasks with one bit per
+ * action (see \ref BINDINGS_ACTION), so reading the state of an action, or of
+ * dozens of them at once, is a bit test.
+ *
+ * An action is held while any of its scancodes is down. It is pressed on the
+ * sample where it becomes held, and released on the sample where it stops
+ * being held. \ref Input_GetHoldCount tells for how many samples in a row it
+ * has been held.
+ *
+ * \warning Only the actions below \ref BINDINGS_MAX_ACTIONS are tracked; the
+ * queries return false or 0 for the others.
+ *
+ * \sa StateManager.input for the input sampled by the state manager.
+ */
+typedef struct Input Input;
+
+Input *Input_Create(const Bindings *bindings);
+void Input_Free(Input *input);
+void Input_Update(Input *input);
+void Input_Sample(Input *input, const bool *keys, int numkeys);
+Uint64 Input_GetHeld(const Input *input);
+Uint64 Input_GetPressed(const Input *input);
+Uint64 Input_GetReleased(const Input *input);
+bool Input_IsHeld(const Input *input, Action action);
+bool Input_IsPressed(const Input *input, Action action);
+bool Input_IsReleased(const Input *input, Action action);
+Uint32 Input_GetHoldCount(const Input *input, Action action);
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "Bindings.h"
+#include "Pair.h"
 
 /**
  * The predefined actions.
@@ -29,6 +30,11 @@ typedef enum {
   OPTION_CUSTOM
 } OptionName;
 
+/**
+ * The version of the files written by \ref Options_Save.
+ */
+#define OPTIONS_FILE_VERSION 1
+
 /**
  * The Options struct handles the global options of the game.
  *
@@ -47,10 +53,48 @@ typedef enum {
  * The functions \ref Options_Clear and \ref Options_ClearAll respectively
  * removes one pair and all pairs.
  *
- * \todo Save and load.
+ * The options are stored in an array indexed by their name, so that getting
+ * an option is a single lookup. Copied values of at most 16 bytes are stored
+ * in the array itself, without allocating. The array grows the first time a
+ * new custom option is set, which moves these values: a pointer returned by
+ * \ref Options_Get is valid until the option is set or cleared again, or a
+ * new custom option is set. The typed
+ * functions, such as \ref Options_SetPairInt and \ref Options_GetPairInt,
+ * handle such values by copy; the getters return their fallback if the option
+ * is not set, or does not have the size of the type.
+ *
+ * \ref Options_Save writes the options and their bindings to a compact binary
+ * file, which \ref Options_Load reads back in a single pass over the loaded
+ * file. Only the values given to \ref Options_Set and the typed setters are
+ * saved, as they are the only ones known to be plain bytes. Loading sets the
+ * saved values and replaces every binding; the options are left untouched if
+ * the file is invalid or of another version (see \ref OPTIONS_FILE_VERSION).
+ * The values are saved as-is, so the file is only meant to be read on the same
+ * platform. \ref Options_Export writes the same content as text, for humans.
+ *
+ * Systems that depend on an option register an \ref OptionObserver with \ref
+ * Options_Observe. Setting or clearing an option only marks it as changed;
+ * \ref Options_Flush then calls the observers of the changed options, once
+ * each, however many times they changed. The state manager flushes its options
+ * once per frame (see \ref StateManager_Advance), so that the dependent
+ * systems recompute their layout once per change. Loading the options marks
+ * the loaded values as changed too. An observer may be removed at any time,
+ * even by an observer during a flush.
  */
 typedef struct Options Options;
 
+/**
+ * A function called by \ref Options_Flush when an option changed.
+ *
+ * \param name The option that changed.
+ * \param options The options, which may be modified. The changes are seen by
+ * the next flush.
+ * \param userdata The pointer given to \ref Options_Observe.
+ */
+typedef void (*OptionObserver)(OptionName name,
+                               Options *options,
+                               void *userdata);
+
 Options *Options_Create();
 void Options_Free(Options *options);
 Bindings *Options_GetBindings(Options *options);
@@ -61,7 +105,31 @@ void Options_SetWithDestroyFunction(Options *options,
                                     size_t count,
                                     void (*onDestroy)(void *value));
 void Options_SetNoCopy(Options *options, OptionName name, void *value);
+void Options_SetInt(Options *options, OptionName name, int value);
+void Options_SetFloat(Options *options, OptionName name, float value);
+void Options_SetBool(Options *options, OptionName name, bool value);
+void Options_SetPairInt(Options *options, OptionName name, PairInt value);
 bool Options_Has(const Options *options, OptionName name);
 void *Options_Get(const Options *options, OptionName name);
+int Options_GetInt(const Options *options, OptionName name, int fallback);
+float Options_GetFloat(const Options *options,
+                       OptionName name,
+                       float fallback);
+bool Options_GetBool(const Options *options, OptionName name, bool fallback);
+PairInt Options_GetPairInt(const Options *options,
+                           OptionName name,
+                           PairInt fallback);
 void Options_Clear(Options *options, OptionName name);
 void Options_ClearAll(Options *options);
+bool Options_Save(const Options *options, const char *path);
+bool Options_Load(Options *options, const char *path);
+bool Options_Export(const Options *options, const char *path);
+void Options_Observe(Options *options,
+                     OptionName name,
+                     OptionObserver callback,
+                     void *userdata);
+void Options_Unobserve(Options *options,
+                       OptionName name,
+                       OptionObserver callback,
+                       void *userdata);
+void Options_Flush(Options *options);
@@ -0,0 +1,88 @@
+/* Small game engine in C.
+  Copyright (C) 2025 Gaëtan Staquet <gaetan.staquet@gmail.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "SDL3/SDL.h"
+
+/**
+ * How many samples are kept for each callback of each state.
+ */
+#define PROFILER_WINDOW 128
+/**
+ * How many different states can be profiled.
+ */
+#define PROFILER_MAX_STATES 16
+
+/**
+ * The callbacks of a state that can be profiled.
+ */
+typedef enum {
+  PROFILER_UPDATE = 0,
+  PROFILER_RENDER,
+  PROFILER_PROCESS_EVENT,
+
+  PROFILER_CALLBACK_COUNT
+} ProfilerCallback;
+
+/**
+ * The timings of a callback over the last \ref PROFILER_WINDOW calls.
+ */
+typedef struct {
+  /**
+   * The shortest call, in nanoseconds.
+   */
+  Uint64 minNS;
+  /**
+   * The average duration of a call, in nanoseconds.
+   */
+  Uint64 avgNS;
+  /**
+   * The 99th percentile of the durations, in nanoseconds.
+   */
+  Uint64 p99NS;
+  /**
+   * How many calls the statistics are computed from.
+   */
+  unsigned int samples;
+} ProfilerStats;
+
+/**
+ * The Profiler struct measures how long the callbacks of each state take.
+ *
+ * Durations are recorded per state name and per callback in a ring buffer
+ * holding the last \ref PROFILER_WINDOW calls, so that the statistics follow
+ * what the game is currently doing. Use \ref Profiler_GetStats to query them,
+ * or \ref Profiler_Log to print a summary of every state.
+ *
+ * The state manager records its dispatches in a profiler only when the engine
+ * is compiled with <code>ENGINE_PROFILING</code>; otherwise, the measurements
+ * are not even compiled.
+ */
+typedef struct Profiler Profiler;
+
+Profiler *Profiler_Create();
+void Profiler_Free(Profiler *profiler);
+void Profiler_Record(Profiler *profiler,
+                     const char *state,
+                     ProfilerCallback callback,
+                     Uint64 durationNS);
+bool Profiler_GetStats(const Profiler *profiler,
+                       const char *state,
+                       ProfilerCallback callback,
+                       ProfilerStats *stats);
+void Profiler_Reset(Profiler *profiler);
+void Profiler_Log(const Profiler *profiler);
@@ -16,72 +16,198 @@
 */
 #pragma once
 
+#include "Engine/Input.h"
 #include "Engine/Options.h"
+#include "Engine/Profiler.h"
 #include "SDL3/SDL.h"
 
 #define STATEMANAGER_OK 0
 #define STATEMANAGER_FULL 1
 #define STATEMANAGER_EMPTY 2
 #define STATEMANAGER_STATE_NULL 3
+#define STATEMANAGER_QUEUE_FULL 4
+
+/**
+ * How many classes of states can be registered.
+ */
+#define STATECLASS_CAPACITY 32
+
+/**
+ * How many transitions can be requested during a single dispatch.
+ */
+#define STATEMANAGER_QUEUE_CAPACITY 8
+
+/**
+ * The default duration of a simulation tick, in milliseconds.
+ */
+#define STATEMANAGER_DEFAULT_TICK_MS 10
+/**
+ * The default maximal number of ticks simulated by one call to \ref
+ * StateManager_Advance.
+ */
+#define STATEMANAGER_DEFAULT_MAX_STEPS 5
+
+/**
+ * The categories of SDL events a state can be interested in.
+ *
+ * \sa StateClass.events
+ */
+typedef enum {
+  /**
+   * Quitting, and the application entering or leaving the background.
+   */
+  EVENT_CATEGORY_APPLICATION = 0,
+  EVENT_CATEGORY_DISPLAY,
+  EVENT_CATEGORY_WINDOW,
+  EVENT_CATEGORY_KEY_DOWN,
+  EVENT_CATEGORY_KEY_UP,
+  /**
+   * Text input and text editing.
+   */
+  EVENT_CATEGORY_TEXT,
+  EVENT_CATEGORY_MOUSE_MOTION,
+  /**
+   * Mouse buttons being pressed or released.
+   */
+  EVENT_CATEGORY_MOUSE_BUTTON,
+  EVENT_CATEGORY_MOUSE_WHEEL,
+  EVENT_CATEGORY_JOYSTICK,
+  EVENT_CATEGORY_GAMEPAD,
+  /**
+   * Fingers touching the screen.
+   */
+  EVENT_CATEGORY_TOUCH,
+  /**
+   * The events registered by the application.
+   */
+  EVENT_CATEGORY_USER,
+  /**
+   * Every event that fits none of the other categories.
+   */
+  EVENT_CATEGORY_OTHER,
+  EVENT_CATEGORY_COUNT,
+} EventCategory;
+
+/**
+ * The bit of a category of events in \ref StateClass.events.
+ */
+#define EVENTMASK(category) (1u << (category))
+/**
+ * Every category of events.
+ */
+#define EVENTMASK_ALL (EVENTMASK(EVENT_CATEGORY_COUNT) - 1)
 
 typedef struct StateManager StateManager;
 
+typedef struct StateClass StateClass;
+
+typedef struct LayerCache LayerCache;
+
 typedef struct State State;
 
+typedef enum {
+  TRANSITION_PUSH = 0,
+  TRANSITION_POP,
+} TransitionType;
+
 /**
- * A state of the game.
+ * A transition requested while the states were being dispatched.
+ *
+ * \sa StateManager for how transitions are deferred.
+ */
+typedef struct {
+  TransitionType type;
+  /**
+   * The state to push, or <code>nullptr</code> for a pop.
+   */
+  State *state;
+} Transition;
+
+/**
+ * The behaviour shared by all the states of a kind.
+ *
+ * Define one constant class per kind of state, with designated initializers,
+ * and give it to \ref State_Create. The functions that are left to
+ * <code>nullptr</code> are replaced by defaults when the class is registered:
+ * the default load, init, destroy and render functions do nothing, the default
+ * update and process event functions stop the propagation, and the default
+ * isTransparent function returns <code>false</code>. The state manager can
+ * thus call every function without checking it first.
  *
  * \since This struct is available since Engine 1.0.0.
  *
- * \sa State_Create to instantiate a new state.
- * \sa StateManager for the manager of states.
+ * \sa StateClass_Register to resolve the defaults of a class.
  */
-struct State {
+struct StateClass {
   /**
-   * The memory of the state.
+   * The name of the kind of state, used to report its timings.
+   */
+  const char *name;
+
+  /**
+   * The loading function of the state.
    *
-   * It can be anything and is managed by the state itself.
+   * It prepares everything that does not need the renderer, such as opening
+   * fonts, rasterizing text into surfaces, or generating a level. If the state
+   * was given to \ref StateManager_Preload, this function runs on a worker
+   * thread; otherwise, it runs right before the init function when the state is
+   * pushed.
+   *
+   * Set a value to <code>*memory</code> to initialize the memory of this state.
+   * Initially, <code>*memory</code> is <code>nullptr</code>, unless the class
+   * has a \ref StateClass.memorySize.
+   *
+   * \warning This function must not call any video or rendering function.
+   *
+   * \param memory A pointer to a pointer.
+   * \param manager The state manager that is loading the state.
    */
-  void *memory;
+  void (*load)(void **memory, StateManager *manager);
 
   /**
    * The initialization function of the state.
    *
-   * Set a value to <code>*memory</code> to initialize the memory of this state,
-   * which will then be passed to the other functions.
-   * Initially, <code>*memory</code> is <code>nullptr</code>.
+   * It runs on the main thread when the state is pushed, after the load
+   * function. Set a value to <code>*memory</code> to initialize the memory of
+   * this state, which will then be passed to the other functions. If the state
+   * has a load function, <code>*memory</code> is whatever that function set;
+   * otherwise, it is initially <code>nullptr</code>, unless the class has a
+   * \ref StateClass.memorySize.
    *
    * \param memory A pointer to a pointer.
    * \param manager The state manager that is calling the function.
-   *
-   * \sa State_SetInit
    */
   void (*init)(void **memory, StateManager *manager);
 
   /**
    * The destruction function of the state.
    *
-   * If the memory has been initialized, it should be freed by this function.
+   * If the memory has been initialized, it should be freed by this function,
+   * except for the block given by the manager when the class has a \ref
+   * StateClass.memorySize: only what the state allocated itself is freed.
+   * If the state was preloaded but never pushed, the memory was only loaded:
+   * the init function did not run on it.
    *
    * \warning Do not attempt to free the state itself. It will be done by the
    * state manager.
    *
    * \param memory The pointer to the memory of the state.
-   *
-   * \sa State_SetDestroy
    */
   void (*destroy)(void *memory);
 
   /**
    * The update function of the state.
    *
+   * When the state manager is driven by \ref StateManager_Advance, this
+   * function is called once per simulation tick, and <code>delta</code> is
+   * always the duration of a tick. The actions held at that tick are in
+   * <code>manager->input</code>.
+   *
    * \param memory The memory of this state.
-   * \param delta The number of milliseconds since the start of the previous frame.
+   * \param delta The number of milliseconds since the previous update.
    * \param manager The state manager that called this function.
    * \return <code>true</code> to let the state manager call the update function
    * of the next state, or <code>false</code> to not let it.
-   *
-   * \sa State_SetUpdate
    */
   bool (*update)(void *memory, Uint64 delta, StateManager *manager);
 
@@ -95,20 +221,23 @@ struct State {
    * \param memory The memory of this state.
    * \return <code>true</code> to let the manager render the next state before
    * this one, or <code>false</code> to render this state now.
-   *
-   * \sa State_SetIsTransparent
    */
   bool (*isTransparent)(const void *memory);
 
   /**
    * The render function of the state.
-
+   *
+   * Since the simulation runs at a fixed rate, a frame is usually rendered
+   * between two ticks. <code>alpha</code> indicates how far: it is 0 right
+   * after a tick and gets closer to 1 as the next tick approaches. A state can
+   * use it to interpolate between its previous and current positions.
+   *
    * \param memory The memory of this state.
    * \param renderer The SDL renderer to use.
-   *
-   * \sa State_SetRender
+   * \param alpha The interpolation factor between the last two ticks, in
+   * [0, 1).
    */
-  void (*render)(void *memory, SDL_Renderer *renderer);
+  void (*render)(void *memory, SDL_Renderer *renderer, float alpha);
 
   /**
    * The function to process an event.
@@ -118,29 +247,114 @@ struct State {
    * \param manager The state manager that called this function.
    * \return <code>true</code> to let the state manager call the process event
    * function of the next state, or <code>false</code> to not let it.
-   *
-   * \sa State_SetProcessEvent
    */
   bool (*processEvent)(void *memory, SDL_Event *event, StateManager *manager);
+
+  /**
+   * The categories of events given to the process event function, as a
+   * combination of \ref EVENTMASK.
+   *
+   * The events of the other categories skip this state entirely: its process
+   * event function is not called, and the events reach the next state as if
+   * the function had returned <code>true</code>. Leave it to 0 to receive
+   * every event.
+   */
+  Uint32 events;
+
+  /**
+   * Whether the states below this one may be rendered once and reused.
+   *
+   * Set it on a transparent state, such as an overlay, under which nothing
+   * moves. While such a state is in the stack, the manager renders the states
+   * below the topmost one into a texture once, then draws that texture on each
+   * frame instead. The texture is rendered again when the stack changes, when
+   * an update or an event reaches one of the cached states, when the size of
+   * the output changes, or when \ref StateManager_InvalidateCache is called.
+   */
+  bool cacheBelow;
+
+  /**
+   * Whether the state is only rendered again when something changed.
+   *
+   * Set it on a state whose frames stay identical until it reacts to an event
+   * or an update, such as a menu. Such a state calls \ref
+   * StateManager_MarkDirty when its look changes. While every visible state is
+   * rendered on demand, \ref StateManager_NeedsRender returns
+   * <code>false</code> until the manager is marked dirty, and the application
+   * may skip clearing, rendering and presenting the frame.
+   */
+  bool renderOnDemand;
+
+  /**
+   * The size of the memory of the state, in bytes, or 0 to let the state
+   * allocate its memory itself.
+   *
+   * If it is positive, <code>*memory</code> points to a zeroed block of that
+   * size when the load function (or the init function, without a load
+   * function) runs. The block is allocated along with the state and recycled
+   * with it, so the state must neither replace nor free it.
+   */
+  size_t memorySize;
+
+  /**
+   * Whether the state is kept once popped.
+   *
+   * Set it on a state that is shown again and again, such as an overlay.
+   * Instead of being destroyed, a popped state of such a class stays dormant in
+   * the manager, along with its resources. \ref StateManager_Acquire hands it
+   * back, and pushing it again runs neither its load nor its init function.
+   */
+  bool keepAlive;
+};
+
+/**
+ * A state of the game.
+ *
+ * \since This struct is available since Engine 1.0.0.
+ *
+ * \sa State_Create to instantiate a new state.
+ * \sa StateManager for the manager of states.
+ */
+struct State {
+  /**
+   * The class of the state, with its defaults resolved.
+   */
+  const StateClass *stateClass;
+
+  /**
+   * The memory of the state.
+   *
+   * It can be anything and is managed by the state itself.
+   */
+  void *memory;
+
+  /**
+   * The thread running the load function, if the state is being preloaded.
+   */
+  SDL_Thread *loader;
+
+  /**
+   * Whether the load function has already run.
+   */
+  bool loaded;
+
+  /**
+   * Whether the init function has already run.
+   */
+  bool initialized;
+
+  /**
+   * The next state in the pool of the class, or among the dormant states of
+   * the manager.
+   */
+  State *next;
 };
 
-State *State_Create();
+const StateClass *StateClass_Register(const StateClass *description);
+void StateClass_FreePools(void);
+State *State_Create(const StateClass *stateClass);
+void State_Free(State *state);
 void *State_GetMemory(State *state);
-void State_SetInit(State *state,
-                   void (*init)(void **memory, StateManager *manager));
-void State_SetDestroy(State *state, void (*destroy)(void *memory));
-void State_SetUpdate(State *state,
-                     bool (*update)(void *memory,
-                                    Uint64 delta,
-                                    StateManager *manager));
-void State_SetIsTransparent(State *state,
-                            bool (*isTransparent)(const void *memory));
-void State_SetRender(State *state,
-                     void (*render)(void *memory, SDL_Renderer *renderer));
-void State_SetProcessEvent(State *state,
-                           bool (*process)(void *memory,
-                                           SDL_Event *event,
-                                           StateManager *manager));
 
 /**
  * Manages the states of the game.
@@ -150,9 +364,44 @@ void State_SetProcessEvent(State *state,
  *
  * \since This struct is available since Engine 1.0.0.
  *
+ * The stack starts with the capacity given to \ref StateManager_Create and
+ * doubles whenever a push does not fit. The states themselves are recycled:
+ * freeing a state puts it back in a pool kept by its class, and \ref
+ * State_Create takes from that pool before allocating. Once the stack and the
+ * pools have grown to fit the game, pushing and popping do not allocate.
+ * \ref StateClass_FreePools releases the pools when the game quits.
+ *
+ * The states of a \ref StateClass.keepAlive class are not even destroyed when
+ * they are popped: the manager keeps them dormant, and \ref
+ * StateManager_Acquire returns one of them, ready to be pushed, before
+ * creating a new state. The dormant states are destroyed with the manager.
+ *
+ * The simulation runs at a fixed rate: \ref StateManager_Advance accumulates
+ * the elapsed time and calls \ref StateManager_Update once per tick, while
+ * \ref StateManager_Render passes to the states how far the frame is between
+ * two ticks. The duration of a tick is set with \ref
+ * StateManager_SetFixedStep. Before the ticks, \ref StateManager_Advance
+ * flushes the options (see \ref Options_Flush), so that their observers learn
+ * about the changes of the previous frame at once.
+ *
+ * States may push and pop states from their update and process event
+ * functions. Since the manager is iterating over its stack at that moment,
+ * these transitions are not applied right away: they are recorded in a queue
+ * and applied in order once the dispatch is over, which is also when the init
+ * and destroy functions run. A state pushed then popped during the same
+ * dispatch is discarded without ever being initialized. Outside of a dispatch,
+ * \ref StateManager_Push and \ref StateManager_Pop take effect immediately.
+ *
+ * Loading a state can be slow. \ref StateManager_Preload runs the load
+ * function of a state on a worker thread ahead of time, so that pushing the
+ * state later only has to run its init function, which uploads the prepared
+ * data to the renderer. Pushing a state whose preloading is not over waits for
+ * it.
+ *
  * \sa StateManager_Create, StateManager_Free, StateManager_Push,
- * StateManager_Pop, StateManager_Update, StateManager_Render, and
- * StateManager_ProcessEvent to manipulate the manager.
+ * StateManager_Pop, StateManager_Preload, StateManager_Advance,
+ * StateManager_Update, StateManager_Render, and StateManager_ProcessEvent to
+ * manipulate the manager.
  */
 struct StateManager {
   /**
@@ -168,19 +417,112 @@ struct StateManager {
    */
   State **states;
   /**
-   * How many states this manager can handle.
+   * How many states the stack can hold before it has to grow.
    */
-  const int capacity;
+  int capacity;
   /**
    * The index of the top element in the stack.
    */
   int top;
+  /**
+   * The duration of a simulation tick, in milliseconds.
+   */
+  Uint64 tickMS;
+  /**
+   * The maximal number of ticks simulated by one call to \ref
+   * StateManager_Advance.
+   */
+  unsigned int maxSteps;
+  /**
+   * The elapsed time that has not been simulated yet, in nanoseconds.
+   */
+  Uint64 accumulatorNS;
+  /**
+   * The interpolation factor passed to the render functions.
+   */
+  float alpha;
+  /**
+   * The transitions waiting for the end of the current dispatch.
+   */
+  Transition transitions[STATEMANAGER_QUEUE_CAPACITY];
+  /**
+   * How many transitions are waiting in the queue.
+   */
+  unsigned int pendingTransitions;
+  /**
+   * The index the top element will have once the queue is applied.
+   */
+  int pendingTop;
+  /**
+   * How many dispatch loops are currently running.
+   */
+  unsigned int dispatching;
+  /**
+   * Serializes the load functions, so that libraries that are not thread-safe
+   * (e.g., the font rasterizer) are never used by two loads at once.
+   */
+  SDL_Mutex *loadLock;
+  /**
+   * The timings of the callbacks of the states, or <code>nullptr</code> if the
+   * engine is not compiled with <code>ENGINE_PROFILING</code>.
+   */
+  Profiler *profiler;
+  /**
+   * The texture holding the states below an overlay.
+   *
+   * \sa StateClass.cacheBelow
+   */
+  LayerCache *layerCache;
+  /**
+   * Whether a state changed since the last frame was rendered.
+   *
+   * \sa StateManager_NeedsRender
+   */
+  bool dirty;
+  /**
+   * For each category of events, the indices of the states interested in it,
+   * from the top of the stack downwards. Each list has room for
+   * <code>capacity</code> indices.
+   *
+   * \sa StateClass.events
+   */
+  int *dispatchLists;
+  /**
+   * How many states are in the list of each category of events.
+   */
+  int dispatchSizes[EVENT_CATEGORY_COUNT];
+  /**
+   * Whether the stack changed since the lists were built.
+   */
+  bool dispatchStale;
+  /**
+   * The popped states waiting to be pushed again.
+   *
+   * \sa StateClass.keepAlive
+   */
+  State *dormant;
+  /**
+   * The state of the actions, sampled at the start of each update, or
+   * <code>nullptr</code> if the manager has no options.
+   */
+  Input *input;
 };
 
 StateManager *StateManager_Create(unsigned int capacity, SDL_Window *window, Options *options);
 void StateManager_Free(StateManager *manager);
 int StateManager_Push(StateManager *manager, State *state);
 int StateManager_Pop(StateManager *manager);
-void StateManager_Update(StateManager *manager, float delta);
+int StateManager_Preload(StateManager *manager, State *state);
+State *StateManager_Acquire(StateManager *manager,
+                            const StateClass *stateClass);
+void StateManager_SetFixedStep(StateManager *manager,
+                               Uint64 tickMS,
+                               unsigned int maxSteps);
+unsigned int StateManager_Advance(StateManager *manager, Uint64 elapsedNS);
+void StateManager_Update(StateManager *manager, Uint64 delta);
 void StateManager_Render(const StateManager *manager, SDL_Renderer *renderer);
+void StateManager_InvalidateCache(StateManager *manager);
+void StateManager_MarkDirty(StateManager *manager);
+void StateManager_ClearDirty(StateManager *manager);
+bool StateManager_NeedsRender(const StateManager *manager);
 void StateManager_ProcessEvent(StateManager *manager, SDL_Event *event);
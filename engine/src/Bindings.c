@@ -14,254 +14,463 @@
   You should have received a copy of the GNU General Public License
   along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
-
 #include "Engine/Bindings.h"
-#include "glib.h"
 
 typedef struct {
-  GSList *list;
-} Container;
+  SDL_Scancode codes[BINDINGS_MAX_SCANCODES];
+  Action aliases[BINDINGS_MAX_ALIASES];
+  unsigned int codeCount;
+  unsigned int aliasCount;
+} Slot;
 
 struct Bindings {
-  GHashTable *associations;
-  GHashTable *aliases;
+  // The bindings of each action, indexed by the action
+  Slot slots[BINDINGS_MAX_ACTIONS];
+  // For each action, the actions whose scancodes match it
+  Uint64 reaches[BINDINGS_MAX_ACTIONS];
+  // For each scancode, the actions it matches, one bit per action
+  Uint64 table[SDL_SCANCODE_COUNT];
+  // Whether the table must be rebuilt before it is used
+  bool stale;
 };
 
-static void onKeyDestroy(gpointer data) {
-  SDL_free(data);
-}
-
-static void onValueDestroy(gpointer data) {
-  Container *cont = data;
-  g_slist_free_full(cont->list, onKeyDestroy);
-  SDL_free(cont);
-}
-
-static inline gpointer makeActionPointer(Action action) {
-  Action *p = SDL_malloc(sizeof(Action));
-  SDL_memcpy(p, &action, sizeof(Action));
-  return p;
-}
-
-static inline gpointer makeScancodePointer(SDL_Scancode code) {
-  SDL_Scancode *p = SDL_malloc(sizeof(SDL_Scancode));
-  SDL_memcpy(p, &code, sizeof(SDL_Scancode));
-  return p;
-}
-
-static void addCodeToContainer(Container *container, SDL_Scancode code) {
-  container->list = g_slist_append(container->list, makeScancodePointer(code));
-}
-
-static void addActionToContainer(Container *container, Action action) {
-  container->list = g_slist_append(container->list, makeActionPointer(action));
-}
-
-static Container *createContainerScancode(SDL_Scancode code) {
-  Container *container = SDL_malloc(sizeof(Container));
-  container->list = nullptr;
-  addCodeToContainer(container, code);
-  return container;
+static bool isValidAction(Action action) {
+  return action >= 0 && action < BINDINGS_MAX_ACTIONS;
 }
 
-static Container *createContainerAction(Action action) {
-  Container *container = SDL_malloc(sizeof(Container));
-  container->list = nullptr;
-  addActionToContainer(container, action);
-  return container;
+static Slot *editSlot(Bindings *bindings, Action action) {
+  if (!isValidAction(action)) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                 "Cannot bind action %d: at most %d actions are supported",
+                 action,
+                 BINDINGS_MAX_ACTIONS);
+    return nullptr;
+  }
+  bindings->stale = true;
+  return &bindings->slots[action];
 }
 
-static gint compareCode(gconstpointer a, gconstpointer b) {
-  const SDL_Scancode *a1 = a;
-  const SDL_Scancode *a2 = b;
-  if (*a1 < *a2) {
-    return -1;
-  } else if (*a1 == *a2) {
-    return 0;
+static int findCode(const Slot *slot, SDL_Scancode code) {
+  for (unsigned int i = 0; i < slot->codeCount; i++) {
+    if (slot->codes[i] == code) {
+      return i;
+    }
   }
-  return 1;
+  return -1;
 }
 
-static gint compareAction(gconstpointer a, gconstpointer b) {
-  const Action *a1 = a;
-  const Action *a2 = b;
-  if (*a1 < *a2) {
-    return -1;
-  } else if (*a1 == *a2) {
-    return 0;
+static int findAlias(const Slot *slot, Action alias) {
+  for (unsigned int i = 0; i < slot->aliasCount; i++) {
+    if (slot->aliases[i] == alias) {
+      return i;
+    }
   }
-  return 1;
+  return -1;
 }
 
-static void removeCodeFromContainer(Container *container, SDL_Scancode code) {
-  if (container == nullptr) {
+static void addCode(Slot *slot, Action action, SDL_Scancode code) {
+  if (findCode(slot, code) != -1) {
     return;
   }
-  GSList *node = g_slist_find_custom(container->list, &code, compareCode);
-  container->list = g_slist_remove_link(container->list, node);
-  g_slist_free_1(node);
-}
-
-static void removeActionFromContainer(Container *container, Action action) {
-  if (container == nullptr) {
+  if (slot->codeCount == BINDINGS_MAX_SCANCODES) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                 "Action %d already has %d scancodes",
+                 action,
+                 BINDINGS_MAX_SCANCODES);
     return;
   }
-  GSList *node = g_slist_find_custom(container->list, &action, compareAction);
-  container->list = g_slist_remove_link(container->list, node);
-  g_slist_free_1(node);
-}
-
-static bool hasAssociation(const Bindings *bindings, Action action) {
-  return g_hash_table_contains(bindings->associations, &action);
-}
-
-static bool hasAlias(const Bindings *bindings, Action action) {
-  return g_hash_table_contains(bindings->aliases, &action);
+  slot->codes[slot->codeCount++] = code;
 }
 
-static void containerToArray(Container *container,
-                             SDL_Scancode **codes,
-                             unsigned int *size) {
-  GSList *codes_list = container->list;
-  *size = g_slist_length(codes_list);
-  *codes = SDL_calloc(*size, sizeof(SDL_Scancode));
-  unsigned int i = 0;
-
-  while (codes_list != nullptr) {
-    SDL_Scancode *value = codes_list->data;
-    (*codes)[i++] = *value;
-    codes_list = codes_list->next;
+static void addAlias(Slot *slot, Action action, Action alias) {
+  if (!isValidAction(alias) || findAlias(slot, alias) != -1) {
+    return;
   }
-}
-
-static bool codeInContainer(Container *container, SDL_Scancode code) {
-  if (container == nullptr) {
-    return false;
+  if (slot->aliasCount == BINDINGS_MAX_ALIASES) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                 "Action %d already has %d aliases",
+                 action,
+                 BINDINGS_MAX_ALIASES);
+    return;
   }
+  slot->aliases[slot->aliasCount++] = alias;
+}
 
-  GSList *codes_list = container->list;
-  while (codes_list != nullptr) {
-    SDL_Scancode *value = codes_list->data;
-    if (*value == code) {
-      return true;
+static void compileTable(Bindings *bindings) {
+  // reaches[a] holds the actions whose scancodes match a: a itself, and every
+  // action it aliases, directly or not. It is the transitive closure of the
+  // aliases, which also handles the cycles.
+  Uint64 *reaches = bindings->reaches;
+  for (int action = 0; action < BINDINGS_MAX_ACTIONS; action++) {
+    const Slot *slot = &bindings->slots[action];
+    reaches[action] = BINDINGS_ACTION(action);
+    for (unsigned int i = 0; i < slot->aliasCount; i++) {
+      reaches[action] |= BINDINGS_ACTION(slot->aliases[i]);
     }
-    codes_list = codes_list->next;
   }
-  return false;
-}
-
-static bool
-codeInAliases(const Bindings *bindings, Container *aliases, SDL_Scancode code) {
-  if (aliases == nullptr) {
-    return false;
+  for (int via = 0; via < BINDINGS_MAX_ACTIONS; via++) {
+    for (int action = 0; action < BINDINGS_MAX_ACTIONS; action++) {
+      if (reaches[action] & BINDINGS_ACTION(via)) {
+        reaches[action] |= reaches[via];
+      }
+    }
   }
 
-  GSList *aliases_list = aliases->list;
-  while (aliases_list != nullptr) {
-    Action *action = aliases_list->data;
-    Container *assoc = g_hash_table_lookup(bindings->associations, action);
-    if (codeInContainer(assoc, code)) {
-      return true;
+  // The scancodes of an action match every action that reaches it
+  SDL_memset(bindings->table, 0, sizeof(bindings->table));
+  for (int target = 0; target < BINDINGS_MAX_ACTIONS; target++) {
+    const Slot *slot = &bindings->slots[target];
+    if (slot->codeCount == 0) {
+      continue;
+    }
+    Uint64 matched = 0;
+    for (int action = 0; action < BINDINGS_MAX_ACTIONS; action++) {
+      if (reaches[action] & BINDINGS_ACTION(target)) {
+        matched |= BINDINGS_ACTION(action);
+      }
+    }
+    for (unsigned int i = 0; i < slot->codeCount; i++) {
+      if (slot->codes[i] >= 0 && slot->codes[i] < SDL_SCANCODE_COUNT) {
+        bindings->table[slot->codes[i]] |= matched;
+      }
     }
-    aliases_list = aliases_list->next;
   }
-  return false;
+
+  bindings->stale = false;
 }
 
 Bindings *Bindings_Create() {
-  Bindings *bindings = SDL_malloc(sizeof(Bindings));
-  bindings->associations = g_hash_table_new_full(
-      g_int_hash, g_int_equal, onKeyDestroy, onValueDestroy);
-  bindings->aliases = g_hash_table_new_full(
-      g_int_hash, g_int_equal, onKeyDestroy, onValueDestroy);
+  Bindings *bindings = SDL_calloc(1, sizeof(Bindings));
+  bindings->stale = true;
   return bindings;
 }
 
 void Bindings_Free(Bindings *bindings) {
-  g_hash_table_destroy(bindings->associations);
-  g_hash_table_destroy(bindings->aliases);
   SDL_free(bindings);
 }
 
 void Bindings_Clear(Bindings *bindings, Action action) {
-  g_hash_table_remove(bindings->associations, &action);
+  Slot *slot = editSlot(bindings, action);
+  if (slot != nullptr) {
+    slot->codeCount = 0;
+  }
 }
 
 void Bindings_ClearAlias(Bindings *bindings, Action action) {
-  g_hash_table_remove(bindings->aliases, &action);
+  Slot *slot = editSlot(bindings, action);
+  if (slot != nullptr) {
+    slot->aliasCount = 0;
+  }
 }
 
 void Bindings_Remove(Bindings *bindings, Action action, SDL_Scancode scancode) {
-  Container *assoc = g_hash_table_lookup(bindings->associations, &action);
-  removeCodeFromContainer(assoc, scancode);
-  if (assoc->list == nullptr) {
-    g_hash_table_remove(bindings->associations, &action);
+  Slot *slot = editSlot(bindings, action);
+  if (slot == nullptr) {
+    return;
+  }
+  int index = findCode(slot, scancode);
+  if (index == -1) {
+    return;
   }
+  // Keep the order in which the scancodes were added
+  SDL_memmove(&slot->codes[index],
+              &slot->codes[index + 1],
+              (slot->codeCount - index - 1) * sizeof(SDL_Scancode));
+  slot->codeCount--;
 }
 
 void Bindings_RemoveAlias(Bindings *bindings, Action action, Action alias) {
-  Container *aliases = g_hash_table_lookup(bindings->aliases, &action);
-  removeActionFromContainer(aliases, alias);
-  if (aliases->list == nullptr) {
-    g_hash_table_remove(bindings->aliases, &action);
+  Slot *slot = editSlot(bindings, action);
+  if (slot == nullptr) {
+    return;
+  }
+  int index = findAlias(slot, alias);
+  if (index == -1) {
+    return;
   }
+  SDL_memmove(&slot->aliases[index],
+              &slot->aliases[index + 1],
+              (slot->aliasCount - index - 1) * sizeof(Action));
+  slot->aliasCount--;
 }
 
 void Bindings_Set(Bindings *bindings, Action action, SDL_Scancode scancode) {
-  g_hash_table_insert(bindings->associations,
-                      makeActionPointer(action),
-                      createContainerScancode(scancode));
+  Slot *slot = editSlot(bindings, action);
+  if (slot != nullptr) {
+    slot->codeCount = 0;
+    addCode(slot, action, scancode);
+  }
 }
 
 void Bindings_SetAlias(Bindings *bindings, Action action, Action alias) {
   if (action == alias) {
     return;
   }
-  g_hash_table_insert(bindings->aliases,
-                      makeActionPointer(action),
-                      createContainerAction(alias));
+  Slot *slot = editSlot(bindings, action);
+  if (slot != nullptr) {
+    slot->aliasCount = 0;
+    addAlias(slot, action, alias);
+  }
 }
 
 void Bindings_Add(Bindings *bindings, Action action, SDL_Scancode scancode) {
-  Container *assoc = g_hash_table_lookup(bindings->associations, &action);
-  if (assoc == nullptr) {
-    Bindings_Set(bindings, action, scancode);
-  } else {
-    addCodeToContainer(assoc, scancode);
+  Slot *slot = editSlot(bindings, action);
+  if (slot != nullptr) {
+    addCode(slot, action, scancode);
   }
 }
 
 void Bindings_AddAlias(Bindings *bindings, Action action, Action alias) {
-  Container *aliases = g_hash_table_lookup(bindings->aliases, &action);
-  if (aliases == nullptr) {
-    Bindings_SetAlias(bindings, action, alias);
-  } else {
-    addActionToContainer(aliases, alias);
+  Slot *slot = editSlot(bindings, action);
+  if (slot != nullptr) {
+    addAlias(slot, action, alias);
   }
 }
 
 bool Bindings_Has(const Bindings *bindings, Action action) {
-  return hasAssociation(bindings, action) || hasAlias(bindings, action);
+  if (!isValidAction(action)) {
+    return false;
+  }
+  const Slot *slot = &bindings->slots[action];
+  return slot->codeCount > 0 || slot->aliasCount > 0;
 }
 
 void Bindings_Get(const Bindings *bindings,
                   Action action,
                   SDL_Scancode **scancodes,
                   unsigned int *length) {
-  Container *assoc = g_hash_table_lookup(bindings->associations, &action);
-  if (assoc == nullptr) {
+  if (!isValidAction(action) || bindings->slots[action].codeCount == 0) {
     *length = 0;
     *scancodes = nullptr;
     return;
   }
-  containerToArray(assoc, scancodes, length);
+  const Slot *slot = &bindings->slots[action];
+  *length = slot->codeCount;
+  *scancodes = SDL_calloc(*length, sizeof(SDL_Scancode));
+  SDL_memcpy(*scancodes, slot->codes, *length * sizeof(SDL_Scancode));
 }
 
 bool Bindings_Matches(const Bindings *bindings,
                       Action action,
                       SDL_Scancode scancode) {
-  Container *assoc = g_hash_table_lookup(bindings->associations, &action);
-  Container *aliases = g_hash_table_lookup(bindings->aliases, &action);
-  return codeInContainer(assoc, scancode) ||
-         codeInAliases(bindings, aliases, scancode);
+  return isValidAction(action) &&
+         (Bindings_ActionsFor(bindings, scancode) & BINDINGS_ACTION(action));
+}
+
+size_t Bindings_GetInto(const Bindings *bindings,
+                        Action action,
+                        SDL_Scancode *scancodes,
+                        size_t capacity) {
+  if (!isValidAction(action)) {
+    return 0;
+  }
+  const Slot *slot = &bindings->slots[action];
+  size_t copied = SDL_min(capacity, slot->codeCount);
+  if (copied > 0) {
+    SDL_memcpy(scancodes, slot->codes, copied * sizeof(SDL_Scancode));
+  }
+  return slot->codeCount;
+}
+
+// Rebuilding the table does not change what the bindings contain
+static void ensureCompiled(const Bindings *bindings) {
+  if (bindings->stale) {
+    compileTable((Bindings *)bindings);
+  }
+}
+
+Uint64 Bindings_ActionsFor(const Bindings *bindings, SDL_Scancode scancode) {
+  if (scancode < 0 || scancode >= SDL_SCANCODE_COUNT) {
+    return 0;
+  }
+  ensureCompiled(bindings);
+  return bindings->table[scancode];
+}
+
+void Bindings_Iterate(const Bindings *bindings,
+                      Action action,
+                      BindingsIterator *iterator) {
+  iterator->bindings = bindings;
+  iterator->current = action;
+  iterator->index = 0;
+  iterator->remaining = 0;
+  iterator->visited = 0;
+  if (!isValidAction(action)) {
+    // Nothing to give
+    iterator->bindings = nullptr;
+    return;
+  }
+  ensureCompiled(bindings);
+  iterator->remaining = bindings->reaches[action] & ~BINDINGS_ACTION(action);
+}
+
+// Whether one of the actions already visited has the scancode
+static bool alreadyVisited(const BindingsIterator *iterator,
+                           SDL_Scancode code) {
+  for (int action = 0; action < BINDINGS_MAX_ACTIONS; action++) {
+    if ((iterator->visited & BINDINGS_ACTION(action)) &&
+        findCode(&iterator->bindings->slots[action], code) != -1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Bindings_Next(BindingsIterator *iterator, SDL_Scancode *scancode) {
+  if (iterator->bindings == nullptr) {
+    return false;
+  }
+  while (true) {
+    const Slot *slot = &iterator->bindings->slots[iterator->current];
+    while (iterator->index < slot->codeCount) {
+      SDL_Scancode code = slot->codes[iterator->index++];
+      if (!alreadyVisited(iterator, code)) {
+        *scancode = code;
+        return true;
+      }
+    }
+
+    // Go to the next aliased action
+    iterator->visited |= BINDINGS_ACTION(iterator->current);
+    if (iterator->remaining == 0) {
+      iterator->bindings = nullptr;
+      return false;
+    }
+    int next = 0;
+    while (!(iterator->remaining & BINDINGS_ACTION(next))) {
+      next++;
+    }
+    iterator->remaining &= ~BINDINGS_ACTION(next);
+    iterator->current = next;
+    iterator->index = 0;
+  }
+}
+
+bool Bindings_Write(const Bindings *bindings, SDL_IOStream *stream) {
+  Uint8 count = 0;
+  for (int action = 0; action < BINDINGS_MAX_ACTIONS; action++) {
+    if (Bindings_Has(bindings, action)) {
+      count++;
+    }
+  }
+  bool ok = SDL_WriteU8(stream, count);
+  for (int action = 0; ok && action < BINDINGS_MAX_ACTIONS; action++) {
+    const Slot *slot = &bindings->slots[action];
+    if (slot->codeCount == 0 && slot->aliasCount == 0) {
+      continue;
+    }
+    ok = SDL_WriteU8(stream, action) && SDL_WriteU8(stream, slot->codeCount) &&
+         SDL_WriteU8(stream, slot->aliasCount);
+    for (unsigned int i = 0; ok && i < slot->codeCount; i++) {
+      ok = SDL_WriteU16LE(stream, slot->codes[i]);
+    }
+    for (unsigned int i = 0; ok && i < slot->aliasCount; i++) {
+      ok = SDL_WriteU8(stream, slot->aliases[i]);
+    }
+  }
+  if (!ok) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_SYSTEM, "Cannot write bindings: %s", SDL_GetError());
+  }
+  return ok;
+}
+
+// Reads the bindings of one action into its slot, checking every value
+static bool readSlot(SDL_IOStream *stream, Slot *slots) {
+  Uint8 action;
+  Uint8 codeCount;
+  Uint8 aliasCount;
+  if (!SDL_ReadU8(stream, &action) || !SDL_ReadU8(stream, &codeCount) ||
+      !SDL_ReadU8(stream, &aliasCount)) {
+    return false;
+  }
+  if (action >= BINDINGS_MAX_ACTIONS || codeCount > BINDINGS_MAX_SCANCODES ||
+      aliasCount > BINDINGS_MAX_ALIASES) {
+    return false;
+  }
+  Slot *slot = &slots[action];
+  for (unsigned int i = 0; i < codeCount; i++) {
+    Uint16 code;
+    if (!SDL_ReadU16LE(stream, &code) || code >= SDL_SCANCODE_COUNT) {
+      return false;
+    }
+    slot->codes[i] = code;
+  }
+  for (unsigned int i = 0; i < aliasCount; i++) {
+    Uint8 alias;
+    if (!SDL_ReadU8(stream, &alias) || alias >= BINDINGS_MAX_ACTIONS) {
+      return false;
+    }
+    slot->aliases[i] = alias;
+  }
+  slot->codeCount = codeCount;
+  slot->aliasCount = aliasCount;
+  return true;
+}
+
+bool Bindings_Read(Bindings *bindings, SDL_IOStream *stream) {
+  // The slots are filled aside, so that invalid data leaves the bindings as
+  // they were
+  Slot slots[BINDINGS_MAX_ACTIONS] = {};
+  Uint8 count;
+  bool ok = SDL_ReadU8(stream, &count);
+  for (unsigned int i = 0; ok && i < count; i++) {
+    ok = readSlot(stream, slots);
+  }
+  if (!ok) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Cannot read bindings: bad data");
+    return false;
+  }
+  SDL_memcpy(bindings->slots, slots, sizeof(slots));
+  bindings->stale = true;
+  return true;
+}
+
+static const char *const actionNames[] = {
+    [ACTION_MOVE_FORWARD] = "MOVE_FORWARD",
+    [ACTION_MOVE_BACKWARD] = "MOVE_BACKWARD",
+    [ACTION_MOVE_LEFT] = "MOVE_LEFT",
+    [ACTION_MOVE_RIGHT] = "MOVE_RIGHT",
+    [ACTION_MENU_UP] = "MENU_UP",
+    [ACTION_MENU_DOWN] = "MENU_DOWN",
+    [ACTION_MENU_LEFT] = "MENU_LEFT",
+    [ACTION_MENU_RIGHT] = "MENU_RIGHT",
+    [ACTION_MENU_BACK] = "MENU_BACK",
+    [ACTION_MENU_OK] = "MENU_OK",
+};
+
+static bool exportAction(SDL_IOStream *stream, Action action) {
+  if (action < ACTION_CUSTOM) {
+    return SDL_IOprintf(stream, "%s", actionNames[action]) > 0;
+  }
+  return SDL_IOprintf(stream, "CUSTOM+%d", action - ACTION_CUSTOM) > 0;
+}
+
+bool Bindings_Export(const Bindings *bindings, SDL_IOStream *stream) {
+  bool ok = true;
+  for (int action = 0; ok && action < BINDINGS_MAX_ACTIONS; action++) {
+    const Slot *slot = &bindings->slots[action];
+    if (slot->codeCount == 0 && slot->aliasCount == 0) {
+      continue;
+    }
+    ok = exportAction(stream, action) && SDL_IOprintf(stream, ":") > 0;
+    for (unsigned int i = 0; ok && i < slot->codeCount; i++) {
+      const char *name = SDL_GetScancodeName(slot->codes[i]);
+      if (name[0] == '\0') {
+        ok = SDL_IOprintf(stream, " #%d", slot->codes[i]) > 0;
+      } else {
+        ok = SDL_IOprintf(stream, " \"%s\"", name) > 0;
+      }
+    }
+    for (unsigned int i = 0; ok && i < slot->aliasCount; i++) {
+      ok = SDL_IOprintf(stream, " ") > 0 &&
+           exportAction(stream, slot->aliases[i]);
+    }
+    ok = ok && SDL_IOprintf(stream, "\n") > 0;
+  }
+  if (!ok) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_SYSTEM, "Cannot export bindings: %s", SDL_GetError());
+  }
+  return ok;
 }
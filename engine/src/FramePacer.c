@@ -0,0 +1,179 @@
+/* Small game engine in C.
+  Copyright (C) 2025 Gaëtan Staquet <gaetan.staquet@gmail.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Engine/FramePacer.h"
+
+struct FramePacer {
+  FramePacerMode mode;
+  FramePacerClock clock;
+  Uint64 targetNS;
+  // The refresh interval of the display if presenting waits for it, or 0
+  Uint64 vsyncNS;
+  Uint64 frameStartNS;
+  FramePacerStats stats;
+};
+
+static Uint64 getSDLTicks(void *) {
+  return SDL_GetTicksNS();
+}
+
+static void delaySDL(void *, Uint64 ns) {
+  SDL_DelayNS(ns);
+}
+
+static void delayPreciseSDL(void *, Uint64 ns) {
+  SDL_DelayPrecise(ns);
+}
+
+static const FramePacerClock sdlClock = {.now = getSDLTicks,
+                                         .delay = delaySDL,
+                                         .delayPrecise = delayPreciseSDL,
+                                         .userdata = nullptr};
+
+static Uint64 now(const FramePacer *pacer) {
+  return pacer->clock.now(pacer->clock.userdata);
+}
+
+FramePacer *FramePacer_Create(unsigned int targetFPS) {
+  FramePacer *pacer = SDL_malloc(sizeof(FramePacer));
+  pacer->mode = FRAMEPACER_BALANCED;
+  pacer->clock = sdlClock;
+  pacer->vsyncNS = 0;
+  pacer->frameStartNS = 0;
+  SDL_zero(pacer->stats);
+  FramePacer_SetTargetFPS(pacer, targetFPS);
+  return pacer;
+}
+
+void FramePacer_Free(FramePacer *pacer) {
+  SDL_free(pacer);
+}
+
+void FramePacer_SetTargetFPS(FramePacer *pacer, unsigned int targetFPS) {
+  pacer->targetNS = targetFPS == 0 ? 0 : SDL_NS_PER_SECOND / targetFPS;
+  pacer->stats.targetNS = pacer->targetNS;
+}
+
+void FramePacer_SetMode(FramePacer *pacer, FramePacerMode mode) {
+  pacer->mode = mode;
+}
+
+void FramePacer_SetVSyncInterval(FramePacer *pacer, Uint64 intervalNS) {
+  pacer->vsyncNS = intervalNS;
+}
+
+void FramePacer_SetRenderer(FramePacer *pacer, SDL_Renderer *renderer) {
+  pacer->vsyncNS = 0;
+  int vsync = SDL_RENDERER_VSYNC_DISABLED;
+  if (renderer == nullptr || !SDL_GetRenderVSync(renderer, &vsync) ||
+      vsync == SDL_RENDERER_VSYNC_DISABLED) {
+    return;
+  }
+
+  SDL_Window *window = SDL_GetRenderWindow(renderer);
+  const SDL_DisplayMode *mode =
+      SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window));
+  if (mode == nullptr || mode->refresh_rate <= 0) {
+    SDL_LogInfo(SDL_LOG_CATEGORY_SYSTEM,
+                "Unknown refresh rate; the frame pacer ignores the vsync");
+    return;
+  }
+  // Adaptive vsync waits for every refresh, like a vsync of 1
+  int interval = vsync > 0 ? vsync : 1;
+  FramePacer_SetVSyncInterval(
+      pacer, SDL_NS_PER_SECOND * interval / mode->refresh_rate);
+}
+
+void FramePacer_SetClock(FramePacer *pacer, const FramePacerClock *clock) {
+  pacer->clock = clock == nullptr ? sdlClock : *clock;
+}
+
+Uint64 FramePacer_BeginFrame(FramePacer *pacer) {
+  Uint64 startNS = now(pacer);
+  Uint64 deltaNS = 0;
+  if (pacer->frameStartNS != 0) {
+    deltaNS = startNS - pacer->frameStartNS;
+    pacer->stats.lastFrameNS = deltaNS;
+    if (pacer->stats.averageFrameNS == 0) {
+      pacer->stats.averageFrameNS = deltaNS;
+    } else {
+      pacer->stats.averageFrameNS =
+          (pacer->stats.averageFrameNS * 7 + deltaNS) / 8;
+    }
+  }
+  pacer->frameStartNS = startNS;
+  pacer->stats.frames++;
+  return deltaNS;
+}
+
+static void waitUntil(const FramePacer *pacer, Uint64 deadlineNS) {
+  const FramePacerClock *clock = &pacer->clock;
+  Uint64 nowNS = now(pacer);
+  if (nowNS >= deadlineNS) {
+    return;
+  }
+
+  switch (pacer->mode) {
+  case FRAMEPACER_POWER_SAVING:
+    clock->delay(clock->userdata, deadlineNS - nowNS);
+    break;
+  case FRAMEPACER_BALANCED:
+    clock->delayPrecise(clock->userdata, deadlineNS - nowNS);
+    break;
+  case FRAMEPACER_LOW_LATENCY:
+    if (deadlineNS - nowNS > FRAMEPACER_SPIN_MARGIN_NS) {
+      clock->delay(clock->userdata,
+                   deadlineNS - nowNS - FRAMEPACER_SPIN_MARGIN_NS);
+    }
+    while (now(pacer) < deadlineNS) {
+    }
+    break;
+  }
+}
+
+// The frame was presented, and that returned on a refresh of the display: the
+// next presentation lands on a later refresh. Counts the refreshes until the
+// first one that meets the target, and sleeps until the one before it, leaving
+// a refresh period for the next frame to work. Refresh rates are not exact, so
+// a refresh within an eighth of a period of the target still meets it.
+static Uint64 getVSyncDeadline(const FramePacer *pacer) {
+  Uint64 vsyncNS = pacer->vsyncNS;
+  Uint64 targetNS = pacer->targetNS - SDL_min(pacer->targetNS, vsyncNS / 8);
+  Uint64 refreshes = SDL_max(1, (targetNS + vsyncNS - 1) / vsyncNS);
+  return now(pacer) + (refreshes - 1) * vsyncNS;
+}
+
+void FramePacer_EndFrame(FramePacer *pacer, bool presented) {
+  Uint64 workNS = now(pacer) - pacer->frameStartNS;
+  pacer->stats.lastWorkNS = workNS;
+  if (pacer->targetNS == 0) {
+    return;
+  }
+  if (workNS >= pacer->targetNS) {
+    pacer->stats.lateFrames++;
+    return;
+  }
+
+  Uint64 deadlineNS = pacer->frameStartNS + pacer->targetNS;
+  if (presented && pacer->vsyncNS > 0) {
+    deadlineNS = getVSyncDeadline(pacer);
+  }
+  waitUntil(pacer, deadlineNS);
+}
+
+void FramePacer_GetStats(const FramePacer *pacer, FramePacerStats *stats) {
+  *stats = pacer->stats;
+}
@@ -0,0 +1,98 @@
+/* Small game engine in C.
+  Copyright (C) 2025 Gaëtan Staquet <gaetan.staquet@gmail.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Engine/Input.h"
+
+struct Input {
+  const Bindings *bindings;
+  Uint64 held;
+  Uint64 pressed;
+  Uint64 released;
+  // For each action, how many samples in a row it has been held
+  Uint32 holdCounts[BINDINGS_MAX_ACTIONS];
+};
+
+Input *Input_Create(const Bindings *bindings) {
+  Input *input = SDL_malloc(sizeof(Input));
+  input->bindings = bindings;
+  input->held = input->pressed = input->released = 0;
+  SDL_zero(input->holdCounts);
+  return input;
+}
+
+void Input_Free(Input *input) {
+  SDL_free(input);
+}
+
+void Input_Update(Input *input) {
+  int numkeys = 0;
+  const bool *keys = SDL_GetKeyboardState(&numkeys);
+  Input_Sample(input, keys, numkeys);
+}
+
+void Input_Sample(Input *input, const bool *keys, int numkeys) {
+  Uint64 held = 0;
+  for (int scancode = 0; scancode < numkeys; scancode++) {
+    if (keys[scancode]) {
+      held |= Bindings_ActionsFor(input->bindings, scancode);
+    }
+  }
+
+  input->pressed = held & ~input->held;
+  input->released = input->held & ~held;
+  input->held = held;
+  for (int action = 0; action < BINDINGS_MAX_ACTIONS; action++) {
+    if (held & BINDINGS_ACTION(action)) {
+      input->holdCounts[action]++;
+    } else {
+      input->holdCounts[action] = 0;
+    }
+  }
+}
+
+Uint64 Input_GetHeld(const Input *input) {
+  return input->held;
+}
+
+Uint64 Input_GetPressed(const Input *input) {
+  return input->pressed;
+}
+
+Uint64 Input_GetReleased(const Input *input) {
+  return input->released;
+}
+
+bool Input_IsHeld(const Input *input, Action action) {
+  return action < BINDINGS_MAX_ACTIONS &&
+         (input->held & BINDINGS_ACTION(action));
+}
+
+bool Input_IsPressed(const Input *input, Action action) {
+  return action < BINDINGS_MAX_ACTIONS &&
+         (input->pressed & BINDINGS_ACTION(action));
+}
+
+bool Input_IsReleased(const Input *input, Action action) {
+  return action < BINDINGS_MAX_ACTIONS &&
+         (input->released & BINDINGS_ACTION(action));
+}
+
+Uint32 Input_GetHoldCount(const Input *input, Action action) {
+  if (action >= BINDINGS_MAX_ACTIONS) {
+    return 0;
+  }
+  return input->holdCounts[action];
+}
@@ -17,61 +17,170 @@
 
 #include "Engine/Options.h"
 #include "SDL3/SDL_stdinc.h"
-#include <glib.h>
+#include <stdalign.h>
 #include <stddef.h>
 
+// Copied values up to this size are stored in their slot
+#define INLINE_SIZE 16
+// Option names are dense: larger ones in a file mean it is corrupted
+#define MAX_LOADED_NAME 65536
+
+typedef enum {
+  SLOT_EMPTY,
+  // The value is a copy stored in the slot
+  SLOT_INLINE,
+  // The value is a copy allocated for the slot
+  SLOT_COPY,
+  // The value belongs to the caller
+  SLOT_BORROWED,
+} SlotKind;
+
 typedef struct {
+  // Where the value is, or nullptr if the option is not set
   void *value;
+  // The size of the value, if it was copied
+  size_t count;
   void (*onDestroy)(void *value);
-} ValueDestroy;
+  SlotKind kind;
+  // Whether the option changed since the last flush
+  bool dirty;
+  // Whether the observers of the option are being told about a change
+  bool pending;
+  alignas(max_align_t) Uint8 bytes[INLINE_SIZE];
+} Slot;
+
+// The first bytes of an options file
+static const char magic[4] = {'S', 'G', 'O', 'P'};
+
+typedef struct {
+  OptionName name;
+  // nullptr if the observer was removed during a flush
+  OptionObserver callback;
+  void *userdata;
+} Observer;
 
 struct Options {
   Bindings *bindings;
 
-  GHashTable *associations;
+  // The options, indexed by their name
+  Slot *slots;
+  int capacity;
+
+  Observer *observers;
+  int observerCount;
+  int observerCapacity;
+  // Whether an option changed since the last flush
+  bool dirty;
+  bool flushing;
 };
 
-static void onKeyDestroy(gpointer data) {
-  SDL_free(data);
+static bool isStored(const Options *options, OptionName name) {
+  return (int)name >= 0 && (int)name < options->capacity;
 }
 
-static void onValueDestroy(gpointer data) {
-  ValueDestroy *value = data;
-  if (value->onDestroy != nullptr) {
-    value->onDestroy(value->value);
-  } else {
-    SDL_free(value->value);
+static const Slot *findSlot(const Options *options, OptionName name) {
+  if (!isStored(options, name)) {
+    return nullptr;
   }
-  SDL_free(value);
+  return &options->slots[name];
 }
 
-static void noDestroy(gpointer) {}
+// Gets the slot of an option, making room for custom options
+static Slot *reserveSlot(Options *options, OptionName name) {
+  if ((int)name < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Invalid option %d", name);
+    return nullptr;
+  }
+  if (!isStored(options, name)) {
+    int capacity = SDL_max((int)name + 1, 2 * options->capacity);
+    Slot *slots = SDL_realloc(options->slots, capacity * sizeof(Slot));
+    if (slots == nullptr) {
+      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                   "Cannot store option %d: %s",
+                   name,
+                   SDL_GetError());
+      return nullptr;
+    }
+    SDL_memset(&slots[options->capacity],
+               0,
+               (capacity - options->capacity) * sizeof(Slot));
+    // The inline values moved with their slots
+    for (int i = 0; i < options->capacity; i++) {
+      if (slots[i].kind == SLOT_INLINE) {
+        slots[i].value = slots[i].bytes;
+      }
+    }
+    options->slots = slots;
+    options->capacity = capacity;
+  }
+  return &options->slots[name];
+}
 
-static inline OptionName *makeOptionPointer(OptionName name) {
-  OptionName *p = SDL_malloc(sizeof(OptionName));
-  SDL_memcpy(p, &name, sizeof(OptionName));
-  return p;
+// Gets the slot of an option that is about to change
+static Slot *changeSlot(Options *options, OptionName name) {
+  Slot *slot = reserveSlot(options, name);
+  if (slot != nullptr) {
+    slot->dirty = true;
+    options->dirty = true;
+  }
+  return slot;
 }
 
-inline static ValueDestroy *createCopy(void *value, size_t count) {
-  ValueDestroy *valueDestroy = SDL_malloc(sizeof(ValueDestroy));
-  valueDestroy->value = SDL_malloc(count);
-  SDL_memcpy(valueDestroy->value, value, count);
-  valueDestroy->onDestroy = nullptr;
-  return valueDestroy;
+static void releaseSlot(Slot *slot) {
+  if (slot->kind == SLOT_COPY) {
+    if (slot->onDestroy != nullptr) {
+      slot->onDestroy(slot->value);
+    } else {
+      SDL_free(slot->value);
+    }
+  }
+  slot->value = nullptr;
+  slot->count = 0;
+  slot->onDestroy = nullptr;
+  slot->kind = SLOT_EMPTY;
+}
+
+// The value is copied before the previous one is released, as it may be a
+// part of it
+static void storeCopy(Slot *slot,
+                      void *value,
+                      size_t count,
+                      void (*onDestroy)(void *value)) {
+  if (count <= INLINE_SIZE && onDestroy == nullptr) {
+    Uint8 bytes[INLINE_SIZE];
+    SDL_memcpy(bytes, value, count);
+    releaseSlot(slot);
+    SDL_memcpy(slot->bytes, bytes, count);
+    slot->value = slot->bytes;
+    slot->kind = SLOT_INLINE;
+  } else {
+    void *copy = SDL_malloc(count);
+    SDL_memcpy(copy, value, count);
+    releaseSlot(slot);
+    slot->value = copy;
+    slot->kind = SLOT_COPY;
+  }
+  slot->count = count;
+  slot->onDestroy = onDestroy;
 }
 
 Options *Options_Create() {
   Options *options = SDL_malloc(sizeof(Options));
   options->bindings = Bindings_Create();
-  options->associations = g_hash_table_new_full(
-      g_int_hash, g_int_equal, onKeyDestroy, onValueDestroy);
+  options->capacity = OPTION_CUSTOM;
+  options->slots = SDL_calloc(options->capacity, sizeof(Slot));
+  options->observers = nullptr;
+  options->observerCount = 0;
+  options->observerCapacity = 0;
+  options->dirty = false;
+  options->flushing = false;
   return options;
 }
 
 void Options_Free(Options *options) {
   Options_ClearAll(options);
-  g_hash_table_destroy(options->associations);
+  SDL_free(options->slots);
+  SDL_free(options->observers);
   Bindings_Free(options->bindings);
   SDL_free(options);
 }
@@ -81,10 +190,10 @@ Bindings *Options_GetBindings(Options *options) {
 }
 
 void Options_Set(Options *options, OptionName name, void *value, size_t count) {
-  ValueDestroy *valueDestroy = createCopy(value, count);
-  valueDestroy->onDestroy = nullptr;
-  g_hash_table_insert(
-      options->associations, makeOptionPointer(name), valueDestroy);
+  Slot *slot = changeSlot(options, name);
+  if (slot != nullptr) {
+    storeCopy(slot, value, count, nullptr);
+  }
 }
 
 void Options_SetWithDestroyFunction(Options *options,
@@ -92,37 +201,320 @@ void Options_SetWithDestroyFunction(Options *options,
                                     void *value,
                                     size_t count,
                                     void (*onDestroy)(void *value)) {
-  ValueDestroy *valueDestroy = createCopy(value, count);
-  valueDestroy->onDestroy = onDestroy;
-  g_hash_table_insert(
-      options->associations, makeOptionPointer(name), valueDestroy);
+  Slot *slot = changeSlot(options, name);
+  if (slot != nullptr) {
+    storeCopy(slot, value, count, onDestroy);
+  }
 }
 
 void Options_SetNoCopy(Options *options, OptionName name, void *value) {
-  ValueDestroy *valueDestroy = SDL_malloc(sizeof(ValueDestroy));
-  valueDestroy->value = value;
-  valueDestroy->onDestroy = noDestroy;
-  g_hash_table_insert(
-      options->associations, makeOptionPointer(name), valueDestroy);
+  Slot *slot = changeSlot(options, name);
+  if (slot != nullptr) {
+    releaseSlot(slot);
+    slot->value = value;
+    slot->kind = SLOT_BORROWED;
+  }
+}
+
+void Options_SetInt(Options *options, OptionName name, int value) {
+  Options_Set(options, name, &value, sizeof(value));
+}
+
+void Options_SetFloat(Options *options, OptionName name, float value) {
+  Options_Set(options, name, &value, sizeof(value));
+}
+
+void Options_SetBool(Options *options, OptionName name, bool value) {
+  Options_Set(options, name, &value, sizeof(value));
+}
+
+void Options_SetPairInt(Options *options, OptionName name, PairInt value) {
+  Options_Set(options, name, &value, sizeof(value));
 }
 
 bool Options_Has(const Options *options, OptionName name) {
-  return g_hash_table_lookup(options->associations, &name) != nullptr;
+  return Options_Get(options, name) != nullptr;
 }
 
 void *Options_Get(const Options *options, OptionName name) {
-  ValueDestroy *value = g_hash_table_lookup(options->associations, &name);
-  if (value == nullptr) {
-    return nullptr;
-  } else {
-    return value->value;
-  }
+  const Slot *slot = findSlot(options, name);
+  return slot == nullptr ? nullptr : slot->value;
+}
+
+// Whether the option holds a copied value of the given size
+static bool holds(const Slot *slot, size_t count) {
+  return slot != nullptr && slot->count == count;
+}
+
+int Options_GetInt(const Options *options, OptionName name, int fallback) {
+  const Slot *slot = findSlot(options, name);
+  return holds(slot, sizeof(int)) ? *(int *)slot->value : fallback;
+}
+
+float Options_GetFloat(const Options *options,
+                       OptionName name,
+                       float fallback) {
+  const Slot *slot = findSlot(options, name);
+  return holds(slot, sizeof(float)) ? *(float *)slot->value : fallback;
+}
+
+bool Options_GetBool(const Options *options, OptionName name, bool fallback) {
+  const Slot *slot = findSlot(options, name);
+  return holds(slot, sizeof(bool)) ? *(bool *)slot->value : fallback;
+}
+
+PairInt Options_GetPairInt(const Options *options,
+                           OptionName name,
+                           PairInt fallback) {
+  const Slot *slot = findSlot(options, name);
+  return holds(slot, sizeof(PairInt)) ? *(PairInt *)slot->value : fallback;
 }
 
 void Options_Clear(Options *options, OptionName name) {
-  g_hash_table_remove(options->associations, &name);
+  if (Options_Has(options, name)) {
+    releaseSlot(changeSlot(options, name));
+  }
 }
 
 void Options_ClearAll(Options *options) {
-  g_hash_table_remove_all(options->associations);
+  for (int i = 0; i < options->capacity; i++) {
+    Options_Clear(options, i);
+  }
+}
+
+void Options_Observe(Options *options,
+                     OptionName name,
+                     OptionObserver callback,
+                     void *userdata) {
+  if (reserveSlot(options, name) == nullptr) {
+    return;
+  }
+  if (options->observerCount == options->observerCapacity) {
+    int capacity = SDL_max(4, 2 * options->observerCapacity);
+    Observer *observers =
+        SDL_realloc(options->observers, capacity * sizeof(Observer));
+    if (observers == nullptr) {
+      SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                   "Cannot observe option %d: %s",
+                   name,
+                   SDL_GetError());
+      return;
+    }
+    options->observers = observers;
+    options->observerCapacity = capacity;
+  }
+  options->observers[options->observerCount++] =
+      (Observer){.name = name, .callback = callback, .userdata = userdata};
+}
+
+void Options_Unobserve(Options *options,
+                       OptionName name,
+                       OptionObserver callback,
+                       void *userdata) {
+  for (int i = 0; i < options->observerCount; i++) {
+    Observer *observer = &options->observers[i];
+    if (observer->name != name || observer->callback != callback ||
+        observer->userdata != userdata) {
+      continue;
+    }
+    if (options->flushing) {
+      // The flush goes through the observers: they are compacted after it
+      observer->callback = nullptr;
+    } else {
+      SDL_memmove(observer,
+                  observer + 1,
+                  (options->observerCount - i - 1) * sizeof(Observer));
+      options->observerCount--;
+    }
+    return;
+  }
+}
+
+void Options_Flush(Options *options) {
+  if (!options->dirty || options->flushing) {
+    return;
+  }
+  // The changes made by the observers are kept for the next flush
+  for (int i = 0; i < options->capacity; i++) {
+    options->slots[i].pending = options->slots[i].dirty;
+    options->slots[i].dirty = false;
+  }
+  options->dirty = false;
+
+  options->flushing = true;
+  for (int i = 0; i < options->observerCount; i++) {
+    // Copied, as the observer may add observers
+    Observer observer = options->observers[i];
+    if (observer.callback != nullptr &&
+        options->slots[observer.name].pending) {
+      observer.callback(observer.name, options, observer.userdata);
+    }
+  }
+  options->flushing = false;
+
+  int kept = 0;
+  for (int i = 0; i < options->observerCount; i++) {
+    if (options->observers[i].callback != nullptr) {
+      options->observers[kept++] = options->observers[i];
+    }
+  }
+  options->observerCount = kept;
+  for (int i = 0; i < options->capacity; i++) {
+    options->slots[i].pending = false;
+  }
+}
+
+// Only the plain copies can be saved: the other values may hold pointers
+static bool isSaved(const Slot *slot) {
+  return slot->kind != SLOT_EMPTY && slot->kind != SLOT_BORROWED &&
+         slot->onDestroy == nullptr;
+}
+
+static bool writeOptions(const Options *options, SDL_IOStream *stream) {
+  Uint32 count = 0;
+  for (int i = 0; i < options->capacity; i++) {
+    count += isSaved(&options->slots[i]);
+  }
+
+  bool ok = SDL_WriteIO(stream, magic, sizeof(magic)) == sizeof(magic) &&
+            SDL_WriteU16LE(stream, OPTIONS_FILE_VERSION) &&
+            SDL_WriteU32LE(stream, count);
+  for (int i = 0; ok && i < options->capacity; i++) {
+    const Slot *slot = &options->slots[i];
+    if (!isSaved(slot)) {
+      continue;
+    }
+    ok = SDL_WriteU32LE(stream, i) && SDL_WriteU32LE(stream, slot->count) &&
+         SDL_WriteIO(stream, slot->value, slot->count) == slot->count;
+  }
+  return ok && Bindings_Write(options->bindings, stream);
+}
+
+bool Options_Save(const Options *options, const char *path) {
+  SDL_IOStream *stream = SDL_IOFromFile(path, "wb");
+  if (stream == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                 "Cannot open %s for writing: %s",
+                 path,
+                 SDL_GetError());
+    return false;
+  }
+  bool ok = writeOptions(options, stream);
+  if (!SDL_CloseIO(stream) || !ok) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Cannot save options to %s", path);
+    return false;
+  }
+  return true;
+}
+
+// Goes through the options of a loaded file, and sets them if apply is true.
+// The values are copied straight from the loaded file.
+static bool readOptions(Options *options,
+                        SDL_IOStream *stream,
+                        const Uint8 *data,
+                        size_t size,
+                        bool apply) {
+  Uint32 count;
+  if (!SDL_ReadU32LE(stream, &count)) {
+    return false;
+  }
+  for (Uint32 i = 0; i < count; i++) {
+    Uint32 name;
+    Uint32 length;
+    if (!SDL_ReadU32LE(stream, &name) || !SDL_ReadU32LE(stream, &length) ||
+        name >= MAX_LOADED_NAME) {
+      return false;
+    }
+    Sint64 offset = SDL_TellIO(stream);
+    if (offset < 0 || length > size - (size_t)offset) {
+      return false;
+    }
+    if (apply) {
+      Options_Set(options, name, (void *)(data + offset), length);
+    }
+    if (SDL_SeekIO(stream, length, SDL_IO_SEEK_CUR) < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool readFile(Options *options, const Uint8 *data, size_t size) {
+  SDL_IOStream *stream = SDL_IOFromConstMem(data, size);
+  if (stream == nullptr) {
+    return false;
+  }
+  char header[sizeof(magic)];
+  Uint16 version;
+  bool ok = SDL_ReadIO(stream, header, sizeof(header)) == sizeof(header) &&
+            SDL_memcmp(header, magic, sizeof(magic)) == 0 &&
+            SDL_ReadU16LE(stream, &version) &&
+            version == OPTIONS_FILE_VERSION;
+  // The options are checked first without being set. The bindings come last,
+  // and Bindings_Read checks all of them before replacing any: if any part of
+  // the file is invalid, nothing has changed.
+  Sint64 start = SDL_TellIO(stream);
+  ok = ok && start >= 0 && readOptions(options, stream, data, size, false);
+  Sint64 end = SDL_TellIO(stream);
+  ok = ok && Bindings_Read(options->bindings, stream);
+  // The options are set once the bindings are, reading exactly what was
+  // checked
+  ok = ok && SDL_SeekIO(stream, start, SDL_IO_SEEK_SET) == start &&
+       readOptions(options, stream, data, size, true) &&
+       SDL_TellIO(stream) == end;
+  SDL_CloseIO(stream);
+  return ok;
+}
+
+bool Options_Load(Options *options, const char *path) {
+  size_t size;
+  Uint8 *data = SDL_LoadFile(path, &size);
+  if (data == nullptr) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_SYSTEM, "Cannot load %s: %s", path, SDL_GetError());
+    return false;
+  }
+  bool ok = readFile(options, data, size);
+  SDL_free(data);
+  if (!ok) {
+    SDL_LogError(
+        SDL_LOG_CATEGORY_SYSTEM, "%s is not a valid options file", path);
+  }
+  return ok;
+}
+
+static bool exportOptions(const Options *options, SDL_IOStream *stream) {
+  bool ok =
+      SDL_IOprintf(stream, "# Options, version %d\n", OPTIONS_FILE_VERSION) > 0;
+  for (int i = 0; ok && i < options->capacity; i++) {
+    const Slot *slot = &options->slots[i];
+    if (!isSaved(slot)) {
+      continue;
+    }
+    ok = SDL_IOprintf(stream, "option %d:", i) > 0;
+    const Uint8 *bytes = slot->value;
+    for (size_t j = 0; ok && j < slot->count; j++) {
+      ok = SDL_IOprintf(stream, " %02x", bytes[j]) > 0;
+    }
+    ok = ok && SDL_IOprintf(stream, "\n") > 0;
+  }
+  ok = ok && SDL_IOprintf(stream, "# Bindings\n") > 0;
+  return ok && Bindings_Export(options->bindings, stream);
+}
+
+bool Options_Export(const Options *options, const char *path) {
+  SDL_IOStream *stream = SDL_IOFromFile(path, "w");
+  if (stream == nullptr) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                 "Cannot open %s for writing: %s",
+                 path,
+                 SDL_GetError());
+    return false;
+  }
+  bool ok = exportOptions(options, stream);
+  if (!SDL_CloseIO(stream) || !ok) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Cannot export options to %s", path);
+    return false;
+  }
+  return true;
 }
@@ -0,0 +1,148 @@
+/* Small game engine in C.
+  Copyright (C) 2025 Gaëtan Staquet <gaetan.staquet@gmail.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Engine/Profiler.h"
+
+typedef struct {
+  Uint64 durations[PROFILER_WINDOW];
+  unsigned int next;
+  unsigned int count;
+} Samples;
+
+typedef struct {
+  const char *name;
+  Samples samples[PROFILER_CALLBACK_COUNT];
+} Entry;
+
+struct Profiler {
+  Entry entries[PROFILER_MAX_STATES];
+  unsigned int size;
+  bool overflowReported;
+};
+
+static const char *callbackNames[PROFILER_CALLBACK_COUNT] = {
+    "update",
+    "render",
+    "processEvent",
+};
+
+Profiler *Profiler_Create() {
+  return SDL_calloc(1, sizeof(Profiler));
+}
+
+void Profiler_Free(Profiler *profiler) {
+  SDL_free(profiler);
+}
+
+static int findEntry(const Profiler *profiler, const char *state) {
+  for (unsigned int i = 0; i < profiler->size; i++) {
+    const char *name = profiler->entries[i].name;
+    // Names are usually string literals, so the pointers are often equal
+    if (name == state || SDL_strcmp(name, state) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void Profiler_Record(Profiler *profiler,
+                     const char *state,
+                     ProfilerCallback callback,
+                     Uint64 durationNS) {
+  int index = findEntry(profiler, state);
+  if (index == -1) {
+    if (profiler->size == PROFILER_MAX_STATES) {
+      if (!profiler->overflowReported) {
+        SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                     "Too many states to profile; ignoring %s",
+                     state);
+        profiler->overflowReported = true;
+      }
+      return;
+    }
+    index = profiler->size++;
+    profiler->entries[index].name = state;
+  }
+
+  Samples *samples = &profiler->entries[index].samples[callback];
+  samples->durations[samples->next] = durationNS;
+  samples->next = (samples->next + 1) % PROFILER_WINDOW;
+  if (samples->count < PROFILER_WINDOW) {
+    samples->count++;
+  }
+}
+
+static int compareDurations(const void *a, const void *b) {
+  Uint64 first = *(const Uint64 *)a;
+  Uint64 second = *(const Uint64 *)b;
+  return (first > second) - (first < second);
+}
+
+static void computeStats(const Samples *samples, ProfilerStats *stats) {
+  Uint64 sorted[PROFILER_WINDOW];
+  Uint64 total = 0;
+  SDL_memcpy(sorted, samples->durations, samples->count * sizeof(Uint64));
+  for (unsigned int i = 0; i < samples->count; i++) {
+    total += sorted[i];
+  }
+  SDL_qsort(sorted, samples->count, sizeof(Uint64), compareDurations);
+
+  stats->samples = samples->count;
+  stats->minNS = sorted[0];
+  stats->avgNS = total / samples->count;
+  // Nearest-rank percentile
+  stats->p99NS = sorted[(samples->count * 99 + 99) / 100 - 1];
+}
+
+bool Profiler_GetStats(const Profiler *profiler,
+                       const char *state,
+                       ProfilerCallback callback,
+                       ProfilerStats *stats) {
+  int index = findEntry(profiler, state);
+  if (index == -1) {
+    return false;
+  }
+  const Samples *samples = &profiler->entries[index].samples[callback];
+  if (samples->count == 0) {
+    return false;
+  }
+  computeStats(samples, stats);
+  return true;
+}
+
+void Profiler_Reset(Profiler *profiler) {
+  SDL_memset(profiler, 0, sizeof(Profiler));
+}
+
+void Profiler_Log(const Profiler *profiler) {
+  for (unsigned int i = 0; i < profiler->size; i++) {
+    const Entry *entry = &profiler->entries[i];
+    for (unsigned int j = 0; j < PROFILER_CALLBACK_COUNT; j++) {
+      if (entry->samples[j].count == 0) {
+        continue;
+      }
+      ProfilerStats stats;
+      computeStats(&entry->samples[j], &stats);
+      SDL_Log("%s %s: min %.3fms, avg %.3fms, p99 %.3fms (%u calls)",
+              entry->name,
+              callbackNames[j],
+              stats.minNS * 1. / SDL_NS_PER_MS,
+              stats.avgNS * 1. / SDL_NS_PER_MS,
+              stats.p99NS * 1. / SDL_NS_PER_MS,
+              stats.samples);
+    }
+  }
+}
@@ -15,56 +15,202 @@
   along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 #include "Engine/StateManager.h"
+#include <stddef.h>
 
 #define EMPTY_STACK -1
 
-State *State_Create() {
-  State *state = SDL_malloc(sizeof(State));
-  state->memory = nullptr;
-  state->init = nullptr;
-  state->destroy = nullptr;
-  state->update = nullptr;
-  state->isTransparent = nullptr;
-  state->render = nullptr;
-  state->processEvent = nullptr;
-  return state;
+struct LayerCache {
+  SDL_Renderer *renderer;
+  SDL_Texture *texture;
+  int w, h;
+  // The index of the highest state rendered in the texture, or EMPTY_STACK if
+  // the texture is stale
+  int depth;
+};
+
+#ifdef ENGINE_PROFILING
+#define PROFILE_START() const Uint64 profileStartNS = SDL_GetTicksNS()
+#define PROFILE_STOP(manager, state, callback)                                 \
+  Profiler_Record((manager)->profiler,                                         \
+                  (state)->stateClass->name,                                   \
+                  (callback),                                                  \
+                  SDL_GetTicksNS() - profileStartNS)
+#else
+#define PROFILE_START()
+#define PROFILE_STOP(manager, state, callback)
+#endif
+
+static void defaultLoad(void **, StateManager *) {}
+
+static void defaultInit(void **, StateManager *) {}
+
+static void defaultDestroy(void *) {}
+
+static bool defaultUpdate(void *, Uint64, StateManager *) {
+  return false;
 }
 
-void *State_GetMemory(State *state) {
-  return state->memory;
+static bool defaultIsTransparent(const void *) {
+  return false;
 }
 
-void State_SetInit(State *state,
-                   void (*init)(void **memory, StateManager *manager)) {
-  state->init = init;
+static void defaultRender(void *, SDL_Renderer *, float) {}
+
+static bool defaultProcessEvent(void *, SDL_Event *, StateManager *) {
+  return false;
 }
 
-void State_SetDestroy(State *state, void (*destroy)(void *memory)) {
-  state->destroy = destroy;
+typedef struct {
+  const StateClass *description;
+  StateClass resolved;
+  // The freed states of this class, ready to be reused
+  State *pool;
+} RegisteredClass;
+
+// Classes are registered from the main thread, when states are created.
+static RegisteredClass registry[STATECLASS_CAPACITY];
+static unsigned int registered = 0;
+
+const StateClass *StateClass_Register(const StateClass *description) {
+  if (description == nullptr) {
+    return nullptr;
+  }
+  for (unsigned int i = 0; i < registered; i++) {
+    if (registry[i].description == description ||
+        &registry[i].resolved == description) {
+      return &registry[i].resolved;
+    }
+  }
+  if (registered == STATECLASS_CAPACITY) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                 "Too many state classes; cannot register %s",
+                 description->name);
+    return nullptr;
+  }
+
+  RegisteredClass *entry = &registry[registered++];
+  entry->description = description;
+  entry->pool = nullptr;
+  StateClass *resolved = &entry->resolved;
+  *resolved = *description;
+  if (resolved->name == nullptr) {
+    resolved->name = "Unnamed state";
+  }
+  if (resolved->load == nullptr) {
+    resolved->load = defaultLoad;
+  }
+  if (resolved->init == nullptr) {
+    resolved->init = defaultInit;
+  }
+  if (resolved->destroy == nullptr) {
+    resolved->destroy = defaultDestroy;
+  }
+  if (resolved->update == nullptr) {
+    resolved->update = defaultUpdate;
+  }
+  if (resolved->isTransparent == nullptr) {
+    resolved->isTransparent = defaultIsTransparent;
+  }
+  if (resolved->render == nullptr) {
+    resolved->render = defaultRender;
+  }
+  if (resolved->processEvent == nullptr) {
+    resolved->processEvent = defaultProcessEvent;
+  }
+  if (resolved->events == 0) {
+    resolved->events = EVENTMASK_ALL;
+  }
+  return resolved;
+}
+
+static RegisteredClass *entryOf(const StateClass *resolved) {
+  return (RegisteredClass *)((char *)resolved -
+                             offsetof(RegisteredClass, resolved));
+}
+
+// The memory of a state is stored right after it, suitably aligned
+static size_t memoryOffset() {
+  const size_t align = alignof(max_align_t);
+  return (sizeof(State) + align - 1) / align * align;
+}
+
+void StateClass_FreePools(void) {
+  for (unsigned int i = 0; i < registered; i++) {
+    while (registry[i].pool != nullptr) {
+      State *state = registry[i].pool;
+      registry[i].pool = state->next;
+      SDL_free(state);
+    }
+  }
 }
 
-void State_SetUpdate(State *state,
-                     bool (*update)(void *memory,
-                                    Uint64 delta,
-                                    StateManager *manager)) {
-  state->update = update;
+State *State_Create(const StateClass *stateClass) {
+  const StateClass *resolved = StateClass_Register(stateClass);
+  if (resolved == nullptr) {
+    return nullptr;
+  }
+  RegisteredClass *entry = entryOf(resolved);
+  State *state = entry->pool;
+  if (state != nullptr) {
+    entry->pool = state->next;
+  } else {
+    state = SDL_malloc(memoryOffset() + resolved->memorySize);
+  }
+  state->stateClass = resolved;
+  state->memory = nullptr;
+  state->loader = nullptr;
+  state->loaded = false;
+  state->initialized = false;
+  state->next = nullptr;
+  if (resolved->memorySize > 0) {
+    state->memory = (char *)state + memoryOffset();
+    SDL_memset(state->memory, 0, resolved->memorySize);
+  }
+  return state;
 }
 
-void State_SetIsTransparent(State *state,
-                            bool (*isTransparent)(const void *memory)) {
-  state->isTransparent = isTransparent;
+// Gives the state back to the pool of its class
+static void recycleState(State *state) {
+  RegisteredClass *entry = entryOf(state->stateClass);
+  state->next = entry->pool;
+  entry->pool = state;
 }
 
-void State_SetRender(State *state,
-                     void (*render)(void *memory, SDL_Renderer *renderer)) {
-  state->render = render;
+void State_Free(State *state) {
+  if (state == nullptr) {
+    return;
+  }
+  if (state->loader != nullptr) {
+    SDL_WaitThread(state->loader, nullptr);
+    state->loader = nullptr;
+    state->loaded = true;
+  }
+  // The init function never ran, but the load function may have allocated
+  // the memory.
+  if (state->loaded) {
+    state->stateClass->destroy(state->memory);
+  }
+  recycleState(state);
 }
 
-void State_SetProcessEvent(State *state,
-                           bool (*process)(void *memory,
-                                           SDL_Event *event,
-                                           StateManager *manager)) {
-  state->processEvent = process;
+void *State_GetMemory(State *state) {
+  return state->memory;
+}
+
+static LayerCache *createLayerCache() {
+  LayerCache *cache = SDL_malloc(sizeof(LayerCache));
+  cache->renderer = nullptr;
+  cache->texture = nullptr;
+  cache->w = cache->h = 0;
+  cache->depth = EMPTY_STACK;
+  return cache;
+}
+
+static void freeLayerCache(LayerCache *cache) {
+  if (cache->texture != nullptr) {
+    SDL_DestroyTexture(cache->texture);
+  }
+  SDL_free(cache);
 }
 
 StateManager *StateManager_Create(unsigned int capacity,
@@ -73,11 +219,34 @@ StateManager *StateManager_Create(unsigned int capacity,
   if (0 == capacity) {
     return nullptr;
   }
-  StateManager managerInit = {window,
-                              options,
-                              SDL_calloc(capacity, sizeof(State *)),
-                              capacity,
-                              EMPTY_STACK};
+  StateManager managerInit = {
+      .mainWindow = window,
+      .options = options,
+      .states = SDL_calloc(capacity, sizeof(State *)),
+      .capacity = capacity,
+      .top = EMPTY_STACK,
+      .tickMS = STATEMANAGER_DEFAULT_TICK_MS,
+      .maxSteps = STATEMANAGER_DEFAULT_MAX_STEPS,
+      .accumulatorNS = 0,
+      .alpha = 0,
+      .pendingTransitions = 0,
+      .pendingTop = EMPTY_STACK,
+      .dispatching = 0,
+      .loadLock = SDL_CreateMutex(),
+#ifdef ENGINE_PROFILING
+      .profiler = Profiler_Create(),
+#else
+      .profiler = nullptr,
+#endif
+      .layerCache = createLayerCache(),
+      .dirty = true,
+      .dispatchLists = SDL_calloc(capacity * EVENT_CATEGORY_COUNT, sizeof(int)),
+      .dispatchSizes = {0},
+      .dispatchStale = true,
+      .dormant = nullptr,
+      .input = options == nullptr ? nullptr
+                                  : Input_Create(Options_GetBindings(options)),
+  };
   StateManager *manager = SDL_malloc(sizeof(StateManager));
   SDL_memcpy(manager, &managerInit, sizeof(StateManager));
   return manager;
@@ -87,63 +256,389 @@ void StateManager_Free(StateManager *manager) {
   while (manager->top != EMPTY_STACK) {
     StateManager_Pop(manager);
   }
+  while (manager->dormant != nullptr) {
+    State *state = manager->dormant;
+    manager->dormant = state->next;
+    State_Free(state);
+  }
+  SDL_DestroyMutex(manager->loadLock);
+  Profiler_Free(manager->profiler);
+  freeLayerCache(manager->layerCache);
+  if (manager->input != nullptr) {
+    Input_Free(manager->input);
+  }
+  SDL_free(manager->dispatchLists);
   SDL_free(manager->states);
   SDL_free(manager);
 }
 
+typedef struct {
+  StateManager *manager;
+  State *state;
+} LoadJob;
+
+static bool hasLoad(const State *state) {
+  return state->stateClass->load != defaultLoad;
+}
+
+static void runLoad(StateManager *manager, State *state) {
+  SDL_LockMutex(manager->loadLock);
+  state->stateClass->load(&state->memory, manager);
+  SDL_UnlockMutex(manager->loadLock);
+}
+
+static int loadInBackground(void *data) {
+  LoadJob *job = data;
+  runLoad(job->manager, job->state);
+  SDL_free(job);
+  return 0;
+}
+
+static void finishLoading(StateManager *manager, State *state) {
+  if (state->loader != nullptr) {
+    SDL_WaitThread(state->loader, nullptr);
+    state->loader = nullptr;
+  } else if (!state->loaded && hasLoad(state)) {
+    runLoad(manager, state);
+  }
+  state->loaded = true;
+}
+
+void StateManager_MarkDirty(StateManager *manager) {
+  manager->dirty = true;
+}
+
+void StateManager_ClearDirty(StateManager *manager) {
+  manager->dirty = false;
+}
+
+void StateManager_InvalidateCache(StateManager *manager) {
+  manager->layerCache->depth = EMPTY_STACK;
+  StateManager_MarkDirty(manager);
+}
+
+// Called before a state receives an update or an event: if it is in the
+// cache, the texture may no longer match what it would render.
+static void touchState(StateManager *manager, int index) {
+  if (index <= manager->layerCache->depth) {
+    StateManager_InvalidateCache(manager);
+  }
+}
+
+static void buildDispatchLists(StateManager *manager) {
+  for (int category = 0; category < EVENT_CATEGORY_COUNT; category++) {
+    int *list = &manager->dispatchLists[category * manager->capacity];
+    int size = 0;
+    for (int current = manager->top; current != EMPTY_STACK; current--) {
+      if (manager->states[current]->stateClass->events & EVENTMASK(category)) {
+        list[size++] = current;
+      }
+    }
+    manager->dispatchSizes[category] = size;
+  }
+  manager->dispatchStale = false;
+}
+
+static bool grow(StateManager *manager) {
+  const int capacity = manager->capacity * 2;
+  // Nothing changes in the manager until both blocks are allocated
+  State **states = SDL_calloc(capacity, sizeof(State *));
+  int *lists = SDL_malloc(capacity * EVENT_CATEGORY_COUNT * sizeof(int));
+  if (states == nullptr || lists == nullptr) {
+    SDL_free(states);
+    SDL_free(lists);
+    return false;
+  }
+  SDL_memcpy(states, manager->states, manager->capacity * sizeof(State *));
+  SDL_free(manager->states);
+  SDL_free(manager->dispatchLists);
+  manager->states = states;
+  manager->dispatchLists = lists;
+  manager->capacity = capacity;
+  // The lists are laid out according to the capacity. The stack itself does
+  // not change here, so they can be rebuilt even during a dispatch.
+  buildDispatchLists(manager);
+  return true;
+}
+
+static void pushNow(StateManager *manager, State *state) {
+  StateManager_InvalidateCache(manager);
+  manager->dispatchStale = true;
+  manager->states[++manager->top] = state;
+  // A dormant state is ready as it is
+  if (!state->initialized) {
+    finishLoading(manager, state);
+    state->stateClass->init(&state->memory, manager);
+    state->initialized = true;
+  }
+}
+
+// Called on a state that leaves the stack, or that will never enter it
+static void retireState(StateManager *manager, State *state) {
+  if (state->stateClass->keepAlive && state->initialized) {
+    state->next = manager->dormant;
+    manager->dormant = state;
+  } else {
+    State_Free(state);
+  }
+}
+
+static void popNow(StateManager *manager) {
+  StateManager_InvalidateCache(manager);
+  manager->dispatchStale = true;
+  State *state = manager->states[manager->top];
+  retireState(manager, state);
+
+  manager->states[manager->top--] = nullptr;
+}
+
+static int
+enqueue(StateManager *manager, TransitionType type, State *state) {
+  if (manager->pendingTransitions == STATEMANAGER_QUEUE_CAPACITY) {
+    return STATEMANAGER_QUEUE_FULL;
+  }
+  Transition *transition = &manager->transitions[manager->pendingTransitions++];
+  transition->type = type;
+  transition->state = state;
+  return STATEMANAGER_OK;
+}
+
+static void beginDispatch(StateManager *manager) {
+  manager->dispatching++;
+}
+
+static void endDispatch(StateManager *manager) {
+  if (--manager->dispatching > 0) {
+    return;
+  }
+
+  // The init and destroy functions may themselves push or pop. Since we are
+  // no longer dispatching, these transitions are applied immediately.
+  for (unsigned int i = 0; i < manager->pendingTransitions; i++) {
+    Transition *transition = &manager->transitions[i];
+    switch (transition->type) {
+    case TRANSITION_PUSH:
+      pushNow(manager, transition->state);
+      break;
+    case TRANSITION_POP:
+      popNow(manager);
+      break;
+    }
+  }
+  manager->pendingTransitions = 0;
+}
+
 int StateManager_Push(StateManager *manager, State *state) {
   if (state == nullptr) {
     return STATEMANAGER_STATE_NULL;
   }
-  if (manager->top + 1 == manager->capacity) {
+  if (manager->pendingTop + 1 == manager->capacity && !grow(manager)) {
     return STATEMANAGER_FULL;
   }
 
-  manager->states[++manager->top] = state;
-
-  if (state->init == nullptr) {
-    SDL_LogInfo(SDL_LOG_CATEGORY_SYSTEM,
-                "A state does not have an init function");
-  } else {
-    state->init(&state->memory, manager);
+  if (manager->dispatching > 0) {
+    int result = enqueue(manager, TRANSITION_PUSH, state);
+    if (result == STATEMANAGER_OK) {
+      manager->pendingTop++;
+    }
+    return result;
   }
 
+  manager->pendingTop++;
+  pushNow(manager, state);
   return STATEMANAGER_OK;
 }
 
 int StateManager_Pop(StateManager *manager) {
-  if (manager->top == EMPTY_STACK) {
+  if (manager->pendingTop == EMPTY_STACK) {
     return STATEMANAGER_EMPTY;
   }
 
-  State *state = manager->states[manager->top];
-  if (state->destroy == nullptr) {
-    SDL_LogInfo(SDL_LOG_CATEGORY_SYSTEM,
-                "A state does not have a destroy function");
-  } else {
-    state->destroy(state->memory);
+  if (manager->dispatching > 0) {
+    unsigned int pending = manager->pendingTransitions;
+    if (pending > 0 &&
+        manager->transitions[pending - 1].type == TRANSITION_PUSH) {
+      // The state was never initialized: both transitions cancel out.
+      retireState(manager, manager->transitions[pending - 1].state);
+      manager->pendingTransitions--;
+    } else {
+      int result = enqueue(manager, TRANSITION_POP, nullptr);
+      if (result != STATEMANAGER_OK) {
+        return result;
+      }
+    }
+    manager->pendingTop--;
+    return STATEMANAGER_OK;
   }
-  SDL_free(state);
 
-  manager->states[manager->top--] = nullptr;
+  manager->pendingTop--;
+  popNow(manager);
+  return STATEMANAGER_OK;
+}
 
+int StateManager_Preload(StateManager *manager, State *state) {
+  if (state == nullptr) {
+    return STATEMANAGER_STATE_NULL;
+  }
+  if (!hasLoad(state) || state->loaded || state->loader != nullptr) {
+    return STATEMANAGER_OK;
+  }
+
+  LoadJob *job = SDL_malloc(sizeof(LoadJob));
+  job->manager = manager;
+  job->state = state;
+  state->loader = SDL_CreateThread(loadInBackground, "StatePreload", job);
+  if (state->loader == nullptr) {
+    // Not fatal: the state will be loaded when it is pushed.
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                 "Could not create a thread to preload a state: %s",
+                 SDL_GetError());
+    SDL_free(job);
+  }
   return STATEMANAGER_OK;
 }
 
-void StateManager_Update(StateManager *manager, float delta) {
+State *StateManager_Acquire(StateManager *manager,
+                            const StateClass *stateClass) {
+  const StateClass *resolved = StateClass_Register(stateClass);
+  if (resolved == nullptr) {
+    return nullptr;
+  }
+  for (State **link = &manager->dormant; *link != nullptr;
+       link = &(*link)->next) {
+    State *state = *link;
+    if (state->stateClass == resolved) {
+      *link = state->next;
+      state->next = nullptr;
+      return state;
+    }
+  }
+  return State_Create(resolved);
+}
+
+void StateManager_SetFixedStep(StateManager *manager,
+                               Uint64 tickMS,
+                               unsigned int maxSteps) {
+  if (tickMS == 0 || maxSteps == 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                 "The duration of a tick and the maximal number of steps "
+                 "must be positive");
+    return;
+  }
+  manager->tickMS = tickMS;
+  manager->maxSteps = maxSteps;
+  manager->accumulatorNS = 0;
+  manager->alpha = 0;
+}
+
+unsigned int StateManager_Advance(StateManager *manager, Uint64 elapsedNS) {
+  const Uint64 tickNS = SDL_MS_TO_NS(manager->tickMS);
+  unsigned int steps = 0;
+
+  // The changes of the previous frame are applied before simulating
+  if (manager->options != nullptr) {
+    Options_Flush(manager->options);
+  }
+
+  manager->accumulatorNS += elapsedNS;
+  while (manager->accumulatorNS >= tickNS && steps < manager->maxSteps) {
+    StateManager_Update(manager, manager->tickMS);
+    manager->accumulatorNS -= tickNS;
+    steps++;
+  }
+
+  // We are too far behind to catch up: drop the time we could not simulate
+  // instead of running ever more ticks on the next frames.
+  if (manager->accumulatorNS >= tickNS) {
+    manager->accumulatorNS %= tickNS;
+  }
+
+  manager->alpha = (double)manager->accumulatorNS / tickNS;
+  return steps;
+}
+
+void StateManager_Update(StateManager *manager, Uint64 delta) {
   int current = manager->top;
   bool cont = true;
+  if (manager->input != nullptr) {
+    Input_Update(manager->input);
+  }
+  beginDispatch(manager);
   while (current != EMPTY_STACK && cont) {
     State *state = manager->states[current];
-    if (state->update == nullptr) {
-      SDL_LogInfo(SDL_LOG_CATEGORY_SYSTEM,
-                  "A state does not have an update function");
-      cont = false;
-    } else {
-      cont = state->update(state->memory, delta, manager);
-    }
+    touchState(manager, current);
+    PROFILE_START();
+    cont = state->stateClass->update(state->memory, delta, manager);
+    PROFILE_STOP(manager, state, PROFILER_UPDATE);
     current--;
   }
+  endDispatch(manager);
+}
+
+static void renderState(const StateManager *manager,
+                        State *state,
+                        SDL_Renderer *renderer) {
+  PROFILE_START();
+  state->stateClass->render(state->memory, renderer, manager->alpha);
+  PROFILE_STOP(manager, state, PROFILER_RENDER);
+}
+
+static bool prepareCacheTexture(LayerCache *cache, SDL_Renderer *renderer) {
+  int w = 0, h = 0;
+  if (!SDL_GetRenderOutputSize(renderer, &w, &h)) {
+    return false;
+  }
+  if (cache->texture != nullptr && cache->renderer == renderer &&
+      cache->w == w && cache->h == h) {
+    return true;
+  }
+
+  if (cache->texture != nullptr) {
+    SDL_DestroyTexture(cache->texture);
+  }
+  cache->texture = SDL_CreateTexture(
+      renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, w, h);
+  cache->renderer = renderer;
+  cache->w = w;
+  cache->h = h;
+  cache->depth = EMPTY_STACK;
+  if (cache->texture == nullptr) {
+    return false;
+  }
+  SDL_SetTextureBlendMode(cache->texture, SDL_BLENDMODE_BLEND);
+  return true;
+}
+
+// Renders the states between first and last (both included) in the cache,
+// unless they are already there.
+static bool fillCache(const StateManager *manager,
+                      SDL_Renderer *renderer,
+                      int first,
+                      int last) {
+  LayerCache *cache = manager->layerCache;
+  if (!prepareCacheTexture(cache, renderer)) {
+    return false;
+  }
+  if (cache->depth == last) {
+    return true;
+  }
+
+  SDL_Texture *target = SDL_GetRenderTarget(renderer);
+  if (!SDL_SetRenderTarget(renderer, cache->texture)) {
+    return false;
+  }
+  Uint8 r, g, b, a;
+  SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_TRANSPARENT);
+  SDL_RenderClear(renderer);
+  SDL_SetRenderDrawColor(renderer, r, g, b, a);
+
+  for (int current = first; current <= last; current++) {
+    renderState(manager, manager->states[current], renderer);
+  }
+  SDL_SetRenderTarget(renderer, target);
+  cache->depth = last;
+  return true;
 }
 
 void StateManager_Render(const StateManager *manager, SDL_Renderer *renderer) {
@@ -152,42 +647,125 @@ void StateManager_Render(const StateManager *manager, SDL_Renderer *renderer) {
   // Seek deepest state to render in the stack
   while (current != EMPTY_STACK && cont) {
     const State *state = manager->states[current];
-    if (state->isTransparent == nullptr) {
-      SDL_LogInfo(SDL_LOG_CATEGORY_SYSTEM,
-                  "A state does not have a isTransparent function");
-      cont = false;
-    } else {
-      cont = state->isTransparent(state->memory);
-    }
+    cont = state->stateClass->isTransparent(state->memory);
     current--;
   }
   current++;
 
+  // Replace the states below the topmost overlay that allows it by the cache
+  for (int overlay = manager->top; overlay > current; overlay--) {
+    if (manager->states[overlay]->stateClass->cacheBelow) {
+      if (fillCache(manager, renderer, current, overlay - 1)) {
+        SDL_RenderTexture(
+            renderer, manager->layerCache->texture, nullptr, nullptr);
+        current = overlay;
+      }
+      break;
+    }
+  }
+
   // Render from the found state
   while (current != manager->top + 1) {
-    State *state = manager->states[current];
-    if (state->render == nullptr) {
-      SDL_LogInfo(SDL_LOG_CATEGORY_SYSTEM,
-                  "A state does not have a render function");
-    } else {
-      state->render(state->memory, renderer);
-    }
+    renderState(manager, manager->states[current], renderer);
     current++;
   }
 }
 
+static bool isWindowChange(const SDL_Event *event) {
+  return event->type == SDL_EVENT_WINDOW_EXPOSED ||
+         event->type == SDL_EVENT_WINDOW_RESIZED ||
+         event->type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED;
+}
+
+bool StateManager_NeedsRender(const StateManager *manager) {
+  if (manager->dirty) {
+    return true;
+  }
+  // Only the visible states matter, and the ones below a cached layer are
+  // drawn from the texture
+  for (int current = manager->top; current != EMPTY_STACK; current--) {
+    const State *state = manager->states[current];
+    if (!state->stateClass->renderOnDemand) {
+      return true;
+    }
+    if (state->stateClass->cacheBelow ||
+        !state->stateClass->isTransparent(state->memory)) {
+      return false;
+    }
+  }
+  return false;
+}
+
+static EventCategory categorize(Uint32 type) {
+  switch (type) {
+  case SDL_EVENT_KEY_DOWN:
+    return EVENT_CATEGORY_KEY_DOWN;
+  case SDL_EVENT_KEY_UP:
+    return EVENT_CATEGORY_KEY_UP;
+  case SDL_EVENT_TEXT_EDITING:
+  case SDL_EVENT_TEXT_INPUT:
+  case SDL_EVENT_TEXT_EDITING_CANDIDATES:
+    return EVENT_CATEGORY_TEXT;
+  case SDL_EVENT_MOUSE_MOTION:
+    return EVENT_CATEGORY_MOUSE_MOTION;
+  case SDL_EVENT_MOUSE_BUTTON_DOWN:
+  case SDL_EVENT_MOUSE_BUTTON_UP:
+    return EVENT_CATEGORY_MOUSE_BUTTON;
+  case SDL_EVENT_MOUSE_WHEEL:
+    return EVENT_CATEGORY_MOUSE_WHEEL;
+  default:
+    break;
+  }
+
+  // The remaining events are grouped by ranges
+  if (type >= SDL_EVENT_USER) {
+    return EVENT_CATEGORY_USER;
+  } else if (type >= SDL_EVENT_QUIT && type < SDL_EVENT_DISPLAY_FIRST) {
+    return EVENT_CATEGORY_APPLICATION;
+  } else if (type >= SDL_EVENT_DISPLAY_FIRST &&
+             type <= SDL_EVENT_DISPLAY_LAST) {
+    return EVENT_CATEGORY_DISPLAY;
+  } else if (type >= SDL_EVENT_WINDOW_FIRST && type <= SDL_EVENT_WINDOW_LAST) {
+    return EVENT_CATEGORY_WINDOW;
+  } else if (type >= SDL_EVENT_JOYSTICK_AXIS_MOTION &&
+             type < SDL_EVENT_GAMEPAD_AXIS_MOTION) {
+    return EVENT_CATEGORY_JOYSTICK;
+  } else if (type >= SDL_EVENT_GAMEPAD_AXIS_MOTION &&
+             type < SDL_EVENT_FINGER_DOWN) {
+    return EVENT_CATEGORY_GAMEPAD;
+  } else if (type >= SDL_EVENT_FINGER_DOWN &&
+             type <= SDL_EVENT_FINGER_CANCELED) {
+    return EVENT_CATEGORY_TOUCH;
+  }
+  return EVENT_CATEGORY_OTHER;
+}
+
 void StateManager_ProcessEvent(StateManager *manager, SDL_Event *event) {
-  int current = manager->top;
+  if (isWindowChange(event)) {
+    StateManager_MarkDirty(manager);
+  }
+  // The transitions are deferred during the dispatch, so the lists stay valid
+  // until it is over
+  if (manager->dispatchStale) {
+    buildDispatchLists(manager);
+  }
+  const EventCategory category = categorize(event->type);
+  const int size = manager->dispatchSizes[category];
+  if (size == 0) {
+    return;
+  }
+
   bool cont = true;
-  while (current != EMPTY_STACK && cont) {
+  beginDispatch(manager);
+  for (int i = 0; i < size && cont; i++) {
+    // A push may grow the stack, which moves the lists
+    const int current =
+        manager->dispatchLists[category * manager->capacity + i];
     State *state = manager->states[current];
-    if (state->processEvent == nullptr) {
-      SDL_LogInfo(SDL_LOG_CATEGORY_SYSTEM,
-                  "A state does not have a process event function");
-      cont = false;
-    } else {
-      cont = state->processEvent(state->memory, event, manager);
-    }
-    current--;
+    touchState(manager, current);
+    PROFILE_START();
+    cont = state->stateClass->processEvent(state->memory, event, manager);
+    PROFILE_STOP(manager, state, PROFILER_PROCESS_EVENT);
   }
+  endDispatch(manager);
 }
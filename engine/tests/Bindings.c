@@ -224,6 +224,198 @@ START_TEST(matches) {
 }
 END_TEST
 
+START_TEST(matches_after_edit) {
+  Bindings *bindings = Bindings_Create();
+  Bindings_Set(bindings, ACTION_MENU_OK, SDL_SCANCODE_SPACE);
+  Bindings_SetAlias(bindings, ACTION_MENU_BACK, ACTION_MENU_OK);
+  ck_assert(Bindings_Matches(bindings, ACTION_MENU_BACK, SDL_SCANCODE_SPACE));
+
+  // Every edit is visible to the next match
+  Bindings_Set(bindings, ACTION_MENU_OK, SDL_SCANCODE_RETURN);
+  ck_assert(!Bindings_Matches(bindings, ACTION_MENU_OK, SDL_SCANCODE_SPACE));
+  ck_assert(Bindings_Matches(bindings, ACTION_MENU_BACK, SDL_SCANCODE_RETURN));
+  Bindings_RemoveAlias(bindings, ACTION_MENU_BACK, ACTION_MENU_OK);
+  ck_assert(
+      !Bindings_Matches(bindings, ACTION_MENU_BACK, SDL_SCANCODE_RETURN));
+  Bindings_Clear(bindings, ACTION_MENU_OK);
+  ck_assert(!Bindings_Matches(bindings, ACTION_MENU_OK, SDL_SCANCODE_RETURN));
+  ck_assert(!Bindings_Matches(bindings, ACTION_MENU_OK, SDL_SCANCODE_COUNT));
+
+  Bindings_Free(bindings);
+}
+END_TEST
+
+START_TEST(bounds) {
+  const Action far = (Action)BINDINGS_MAX_ACTIONS;
+  Bindings *bindings = Bindings_Create();
+
+  // Actions beyond the maximum are ignored
+  Bindings_Set(bindings, far, SDL_SCANCODE_SPACE);
+  Bindings_SetAlias(bindings, ACTION_MENU_OK, far);
+  ck_assert(!Bindings_Has(bindings, far));
+  ck_assert(!Bindings_Has(bindings, ACTION_MENU_OK));
+  ck_assert(!Bindings_Matches(bindings, far, SDL_SCANCODE_SPACE));
+
+  // So are the scancodes beyond the maximum, and the duplicates
+  for (int i = 0; i < BINDINGS_MAX_SCANCODES + 1; i++) {
+    Bindings_Add(bindings, ACTION_MENU_OK, (SDL_Scancode)(i + 1));
+  }
+  Bindings_Add(bindings, ACTION_MENU_OK, (SDL_Scancode)1);
+  SDL_Scancode *scancodes;
+  unsigned int size;
+  Bindings_Get(bindings, ACTION_MENU_OK, &scancodes, &size);
+  ck_assert_uint_eq(size, BINDINGS_MAX_SCANCODES);
+  SDL_free(scancodes);
+  ck_assert(Bindings_Matches(
+      bindings, ACTION_MENU_OK, (SDL_Scancode)BINDINGS_MAX_SCANCODES));
+  ck_assert(!Bindings_Matches(
+      bindings, ACTION_MENU_OK, (SDL_Scancode)(BINDINGS_MAX_SCANCODES + 1)));
+
+  // Removing what is not bound does nothing
+  Bindings_Remove(bindings, ACTION_MENU_BACK, SDL_SCANCODE_SPACE);
+  Bindings_RemoveAlias(bindings, ACTION_MENU_BACK, ACTION_MENU_OK);
+  ck_assert(!Bindings_Has(bindings, ACTION_MENU_BACK));
+
+  Bindings_Free(bindings);
+}
+END_TEST
+
+START_TEST(actions_for) {
+  Bindings *bindings = Bindings_Create();
+  ck_assert_uint_eq(Bindings_ActionsFor(bindings, SDL_SCANCODE_SPACE), 0);
+
+  Bindings_Set(bindings, ACTION_MENU_OK, SDL_SCANCODE_SPACE);
+  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_UP);
+  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_SPACE);
+  Bindings_SetAlias(bindings, ACTION_MENU_UP, ACTION_MOVE_FORWARD);
+
+  ck_assert_uint_eq(Bindings_ActionsFor(bindings, SDL_SCANCODE_SPACE),
+                    BINDINGS_ACTION(ACTION_MENU_OK) |
+                        BINDINGS_ACTION(ACTION_MOVE_FORWARD) |
+                        BINDINGS_ACTION(ACTION_MENU_UP));
+  ck_assert_uint_eq(Bindings_ActionsFor(bindings, SDL_SCANCODE_UP),
+                    BINDINGS_ACTION(ACTION_MOVE_FORWARD) |
+                        BINDINGS_ACTION(ACTION_MENU_UP));
+  ck_assert_uint_eq(Bindings_ActionsFor(bindings, SDL_SCANCODE_W), 0);
+
+  Bindings_Free(bindings);
+}
+END_TEST
+
+START_TEST(transitive_aliases) {
+  const Action far = (Action)ACTION_TEST;
+  Bindings *bindings = Bindings_Create();
+  Bindings_Set(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_W);
+  Bindings_Set(bindings, far, SDL_SCANCODE_UP);
+  // MENU_UP -> MOVE_FORWARD -> far -> MENU_UP
+  Bindings_SetAlias(bindings, ACTION_MENU_UP, ACTION_MOVE_FORWARD);
+  Bindings_SetAlias(bindings, ACTION_MOVE_FORWARD, far);
+  Bindings_SetAlias(bindings, far, ACTION_MENU_UP);
+
+  ck_assert(Bindings_Matches(bindings, ACTION_MENU_UP, SDL_SCANCODE_W));
+  ck_assert(Bindings_Matches(bindings, ACTION_MENU_UP, SDL_SCANCODE_UP));
+  ck_assert(Bindings_Matches(bindings, far, SDL_SCANCODE_W));
+  ck_assert_uint_eq(Bindings_ActionsFor(bindings, SDL_SCANCODE_UP),
+                    BINDINGS_ACTION(ACTION_MENU_UP) |
+                        BINDINGS_ACTION(ACTION_MOVE_FORWARD) |
+                        BINDINGS_ACTION(far));
+
+  // Breaking the chain
+  Bindings_ClearAlias(bindings, ACTION_MOVE_FORWARD);
+  ck_assert(!Bindings_Matches(bindings, ACTION_MENU_UP, SDL_SCANCODE_UP));
+  ck_assert(Bindings_Matches(bindings, far, SDL_SCANCODE_W));
+
+  Bindings_Free(bindings);
+}
+END_TEST
+
+START_TEST(get_into) {
+  Bindings *bindings = Bindings_Create();
+  SDL_Scancode scancodes[2];
+  ck_assert_uint_eq(Bindings_GetInto(bindings, ACTION_MENU_OK, scancodes, 2),
+                    0);
+
+  Bindings_Add(bindings, ACTION_MENU_OK, SDL_SCANCODE_SPACE);
+  Bindings_Add(bindings, ACTION_MENU_OK, SDL_SCANCODE_RETURN);
+  Bindings_Add(bindings, ACTION_MENU_OK, SDL_SCANCODE_KP_ENTER);
+  ck_assert_uint_eq(Bindings_GetInto(bindings, ACTION_MENU_OK, scancodes, 2),
+                    3);
+  ck_assert_int_eq(scancodes[0], SDL_SCANCODE_SPACE);
+  ck_assert_int_eq(scancodes[1], SDL_SCANCODE_RETURN);
+  ck_assert_uint_eq(Bindings_GetInto(bindings, ACTION_MENU_OK, nullptr, 0), 3);
+
+  Bindings_Free(bindings);
+}
+END_TEST
+
+START_TEST(iterate) {
+  Bindings *bindings = Bindings_Create();
+  BindingsIterator iterator;
+  SDL_Scancode scancode;
+  Bindings_Iterate(bindings, ACTION_MENU_UP, &iterator);
+  ck_assert(!Bindings_Next(&iterator, &scancode));
+
+  Bindings_Set(bindings, ACTION_MENU_UP, SDL_SCANCODE_KP_5);
+  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_UP);
+  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_KP_5);
+  Bindings_Add(bindings, (Action)ACTION_TEST, SDL_SCANCODE_W);
+  Bindings_SetAlias(bindings, ACTION_MENU_UP, (Action)ACTION_TEST);
+  Bindings_SetAlias(bindings, (Action)ACTION_TEST, ACTION_MOVE_FORWARD);
+
+  // The scancodes of the action come first, then those of its aliases,
+  // without repetitions
+  Bindings_Iterate(bindings, ACTION_MENU_UP, &iterator);
+  ck_assert(Bindings_Next(&iterator, &scancode));
+  ck_assert_int_eq(scancode, SDL_SCANCODE_KP_5);
+  ck_assert(Bindings_Next(&iterator, &scancode));
+  ck_assert_int_eq(scancode, SDL_SCANCODE_UP);
+  ck_assert(Bindings_Next(&iterator, &scancode));
+  ck_assert_int_eq(scancode, SDL_SCANCODE_W);
+  ck_assert(!Bindings_Next(&iterator, &scancode));
+  ck_assert(!Bindings_Next(&iterator, &scancode));
+
+  Bindings_Free(bindings);
+}
+END_TEST
+
+START_TEST(write_read) {
+  Bindings *bindings = Bindings_Create();
+  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_W);
+  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_UP);
+  Bindings_Set(bindings, (Action)ACTION_TEST, SDL_SCANCODE_SPACE);
+  Bindings_SetAlias(bindings, ACTION_MENU_UP, ACTION_MOVE_FORWARD);
+  SDL_IOStream *stream = SDL_IOFromDynamicMem();
+  ck_assert(Bindings_Write(bindings, stream));
+
+  Bindings *read = Bindings_Create();
+  Bindings_Set(read, ACTION_MENU_OK, SDL_SCANCODE_RETURN);
+  SDL_SeekIO(stream, 0, SDL_IO_SEEK_SET);
+  ck_assert(Bindings_Read(read, stream));
+  ck_assert(!Bindings_Has(read, ACTION_MENU_OK));
+  SDL_Scancode codes[BINDINGS_MAX_SCANCODES];
+  ck_assert_uint_eq(
+      Bindings_GetInto(
+          read, ACTION_MOVE_FORWARD, codes, BINDINGS_MAX_SCANCODES),
+      2);
+  ck_assert_int_eq(codes[0], SDL_SCANCODE_W);
+  ck_assert_int_eq(codes[1], SDL_SCANCODE_UP);
+  ck_assert(Bindings_Matches(read, (Action)ACTION_TEST, SDL_SCANCODE_SPACE));
+  ck_assert(Bindings_Matches(read, ACTION_MENU_UP, SDL_SCANCODE_W));
+
+  // Invalid data leaves the bindings as they were
+  SDL_SeekIO(stream, 0, SDL_IO_SEEK_SET);
+  SDL_WriteU8(stream, 1);
+  SDL_WriteU8(stream, BINDINGS_MAX_ACTIONS);
+  SDL_SeekIO(stream, 0, SDL_IO_SEEK_SET);
+  ck_assert(!Bindings_Read(read, stream));
+  ck_assert(Bindings_Matches(read, ACTION_MENU_UP, SDL_SCANCODE_W));
+
+  SDL_CloseIO(stream);
+  Bindings_Free(read);
+  Bindings_Free(bindings);
+}
+END_TEST
+
 Suite *makeBindingsSuite(void) {
   Suite *suite = suite_create("Bindings manager");
   TCase *tc_core = tcase_create("Data structure");
@@ -238,6 +430,13 @@ Suite *makeBindingsSuite(void) {
   tcase_add_test(tc_core, remove);
   tcase_add_test(tc_core, get);
   tcase_add_test(tc_core, matches);
+  tcase_add_test(tc_core, matches_after_edit);
+  tcase_add_test(tc_core, bounds);
+  tcase_add_test(tc_core, actions_for);
+  tcase_add_test(tc_core, transitive_aliases);
+  tcase_add_test(tc_core, get_into);
+  tcase_add_test(tc_core, iterate);
+  tcase_add_test(tc_core, write_read);
 
   return suite;
 }
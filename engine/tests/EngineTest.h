@@ -24,3 +24,6 @@ void clean(void);
 Suite *makeStateManagerSuite(void);
 Suite *makeBindingsSuite(void);
 Suite *makeOptionsSuite(void);
+Suite *makeProfilerSuite(void);
+Suite *makeFramePacerSuite(void);
+Suite *makeInputSuite(void);
@@ -23,6 +23,9 @@ int main(void) {
   SRunner *runner = srunner_create(makeStateManagerSuite());
   srunner_add_suite(runner, makeBindingsSuite());
   srunner_add_suite(runner, makeOptionsSuite());
+  srunner_add_suite(runner, makeProfilerSuite());
+  srunner_add_suite(runner, makeFramePacerSuite());
+  srunner_add_suite(runner, makeInputSuite());
   // srunner_set_fork_status(runner, CK_NOFORK);
   srunner_run_all(runner, CK_VERBOSE);
   clean();
@@ -0,0 +1,231 @@
+/* Small game engine in C.
+  Copyright (C) 2025 Gaëtan Staquet <gaetan.staquet@gmail.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Engine/FramePacer.h"
+#include "EngineTest.h"
+#include <check.h>
+
+START_TEST(first_frame) {
+  FramePacer *pacer = FramePacer_Create(60);
+  FramePacerStats stats;
+  FramePacer_GetStats(pacer, &stats);
+  ck_assert_uint_eq(stats.targetNS, SDL_NS_PER_SECOND / 60);
+  ck_assert_uint_eq(stats.frames, 0);
+
+  ck_assert_uint_eq(FramePacer_BeginFrame(pacer), 0);
+  FramePacer_GetStats(pacer, &stats);
+  ck_assert_uint_eq(stats.frames, 1);
+
+  FramePacer_Free(pacer);
+}
+END_TEST
+
+// A clock that only moves when told to. Each reading takes a microsecond, so
+// that spinning until a deadline ends.
+typedef struct {
+  Uint64 nowNS;
+  Uint64 sleptNS;
+  unsigned int delays;
+} FakeClock;
+
+static Uint64 readFake(void *userdata) {
+  FakeClock *clock = userdata;
+  clock->nowNS += SDL_NS_PER_US;
+  return clock->nowNS;
+}
+
+static void delayFake(void *userdata, Uint64 ns) {
+  FakeClock *clock = userdata;
+  clock->nowNS += ns;
+  clock->sleptNS += ns;
+  clock->delays++;
+}
+
+static FramePacer *createFakePacer(unsigned int targetFPS, FakeClock *clock) {
+  *clock = (FakeClock){.nowNS = SDL_NS_PER_SECOND};
+  FramePacerClock fake = {.now = readFake,
+                          .delay = delayFake,
+                          .delayPrecise = delayFake,
+                          .userdata = clock};
+  FramePacer *pacer = FramePacer_Create(targetFPS);
+  FramePacer_SetClock(pacer, &fake);
+  return pacer;
+}
+
+static void checkPacing(FramePacerMode mode) {
+  FakeClock clock;
+  FramePacer *pacer = createFakePacer(100, &clock);
+  FramePacer_SetMode(pacer, mode);
+
+  FramePacer_BeginFrame(pacer);
+  clock.nowNS += SDL_MS_TO_NS(3);
+  FramePacer_EndFrame(pacer, false);
+  ck_assert_uint_ge(clock.delays, 1);
+  Uint64 delta = FramePacer_BeginFrame(pacer);
+  ck_assert_uint_ge(delta, SDL_MS_TO_NS(10));
+  ck_assert_uint_lt(delta, SDL_MS_TO_NS(10) + 10 * SDL_NS_PER_US);
+
+  FramePacerStats stats;
+  FramePacer_GetStats(pacer, &stats);
+  ck_assert_uint_eq(stats.lastFrameNS, delta);
+  ck_assert_uint_eq(stats.averageFrameNS, delta);
+  ck_assert_uint_ge(stats.lastWorkNS, SDL_MS_TO_NS(3));
+  ck_assert_uint_lt(stats.lastWorkNS, SDL_MS_TO_NS(3) + 10 * SDL_NS_PER_US);
+  ck_assert_uint_eq(stats.lateFrames, 0);
+
+  FramePacer_Free(pacer);
+}
+
+START_TEST(waits_for_target) {
+  checkPacing(FRAMEPACER_POWER_SAVING);
+  checkPacing(FRAMEPACER_BALANCED);
+  checkPacing(FRAMEPACER_LOW_LATENCY);
+}
+END_TEST
+
+START_TEST(low_latency_spins) {
+  FakeClock clock;
+  FramePacer *pacer = createFakePacer(100, &clock);
+  FramePacer_SetMode(pacer, FRAMEPACER_LOW_LATENCY);
+
+  FramePacer_BeginFrame(pacer);
+  FramePacer_EndFrame(pacer, false);
+  // The last margin before the deadline is spent reading the clock
+  ck_assert_uint_eq(clock.delays, 1);
+  ck_assert_uint_le(clock.sleptNS,
+                    SDL_MS_TO_NS(10) - FRAMEPACER_SPIN_MARGIN_NS);
+  ck_assert_uint_ge(FramePacer_BeginFrame(pacer), SDL_MS_TO_NS(10));
+
+  FramePacer_Free(pacer);
+}
+END_TEST
+
+// Presenting waits for the next refresh of the display. Returns the time of
+// that refresh.
+static Uint64 presentFake(FakeClock *clock, Uint64 vsyncNS) {
+  clock->nowNS += vsyncNS - clock->nowNS % vsyncNS;
+  return clock->nowNS;
+}
+
+// Checks how many refreshes apart the presentations land
+static void checkVSync(unsigned int targetFPS,
+                       Uint64 vsyncNS,
+                       Uint64 expectedRefreshes) {
+  FakeClock clock;
+  FramePacer *pacer = createFakePacer(targetFPS, &clock);
+  FramePacer_SetVSyncInterval(pacer, vsyncNS);
+
+  Uint64 previous = 0;
+  for (int frame = 0; frame < 10; frame++) {
+    FramePacer_BeginFrame(pacer);
+    clock.nowNS += SDL_MS_TO_NS(1);
+    Uint64 presented = presentFake(&clock, vsyncNS);
+    FramePacer_EndFrame(pacer, true);
+    if (frame > 0) {
+      ck_assert_uint_eq(presented - previous, expectedRefreshes * vsyncNS);
+    }
+    previous = presented;
+  }
+
+  FramePacer_Free(pacer);
+}
+
+START_TEST(vsync) {
+  // The target is not a multiple of the refresh period: never go faster
+  checkVSync(60, SDL_NS_PER_SECOND / 144, 3);
+  checkVSync(30, SDL_NS_PER_SECOND / 60, 2);
+  // The refresh meets the target, even if the display is slightly faster
+  checkVSync(60, SDL_NS_PER_SECOND / 60, 1);
+  checkVSync(60, (Uint64)(SDL_NS_PER_SECOND / 60.02), 1);
+  checkVSync(144, SDL_NS_PER_SECOND / 60, 1);
+}
+END_TEST
+
+START_TEST(vsync_not_presented) {
+  FakeClock clock;
+  FramePacer *pacer = createFakePacer(100, &clock);
+  FramePacer_SetVSyncInterval(pacer, SDL_NS_PER_SECOND / 144);
+
+  // Nothing blocks when nothing is presented: sleep for the whole frame
+  FramePacer_BeginFrame(pacer);
+  FramePacer_EndFrame(pacer, false);
+  ck_assert_uint_ge(FramePacer_BeginFrame(pacer), SDL_MS_TO_NS(10));
+
+  FramePacer_Free(pacer);
+}
+END_TEST
+
+START_TEST(late_frame) {
+  FakeClock clock;
+  FramePacer *pacer = createFakePacer(1000, &clock);
+  FramePacer_BeginFrame(pacer);
+  clock.nowNS += SDL_MS_TO_NS(2);
+  FramePacer_EndFrame(pacer, false);
+
+  FramePacerStats stats;
+  FramePacer_GetStats(pacer, &stats);
+  ck_assert_uint_ge(stats.lastWorkNS, SDL_MS_TO_NS(2));
+  ck_assert_uint_eq(stats.lateFrames, 1);
+  ck_assert_uint_eq(clock.delays, 0);
+
+  FramePacer_Free(pacer);
+}
+END_TEST
+
+START_TEST(uncapped) {
+  FakeClock clock;
+  FramePacer *pacer = createFakePacer(0, &clock);
+  FramePacer_BeginFrame(pacer);
+  FramePacer_EndFrame(pacer, false);
+  ck_assert_uint_eq(clock.delays, 0);
+
+  FramePacerStats stats;
+  FramePacer_GetStats(pacer, &stats);
+  ck_assert_uint_eq(stats.targetNS, 0);
+  ck_assert_uint_eq(stats.lateFrames, 0);
+
+  FramePacer_Free(pacer);
+}
+END_TEST
+
+START_TEST(sdl_clock) {
+  // Only lower bounds hold on a loaded machine
+  FramePacer *pacer = FramePacer_Create(100);
+  FramePacer_SetClock(pacer, nullptr);
+  FramePacer_BeginFrame(pacer);
+  FramePacer_EndFrame(pacer, false);
+  ck_assert_uint_ge(FramePacer_BeginFrame(pacer), SDL_MS_TO_NS(10));
+
+  FramePacer_Free(pacer);
+}
+END_TEST
+
+Suite *makeFramePacerSuite(void) {
+  Suite *suite = suite_create("Frame pacer");
+  TCase *tc_core = tcase_create("Pacing");
+  suite_add_tcase(suite, tc_core);
+
+  tcase_add_test(tc_core, first_frame);
+  tcase_add_test(tc_core, waits_for_target);
+  tcase_add_test(tc_core, low_latency_spins);
+  tcase_add_test(tc_core, vsync);
+  tcase_add_test(tc_core, vsync_not_presented);
+  tcase_add_test(tc_core, late_frame);
+  tcase_add_test(tc_core, uncapped);
+  tcase_add_test(tc_core, sdl_clock);
+
+  return suite;
+}
@@ -0,0 +1,93 @@
+/* Small game engine in C.
+  Copyright (C) 2025 Gaëtan Staquet <gaetan.staquet@gmail.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Engine/Input.h"
+#include "EngineTest.h"
+#include <check.h>
+
+START_TEST(sample_actions) {
+  Bindings *bindings = Bindings_Create();
+  Bindings_Set(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_W);
+  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_UP);
+  Bindings_Set(bindings, ACTION_MENU_OK, SDL_SCANCODE_SPACE);
+  Input *input = Input_Create(bindings);
+  bool keys[SDL_SCANCODE_COUNT] = {false};
+
+  Input_Sample(input, keys, SDL_SCANCODE_COUNT);
+  ck_assert_uint_eq(Input_GetHeld(input), 0);
+  ck_assert(!Input_IsPressed(input, ACTION_MOVE_FORWARD));
+
+  keys[SDL_SCANCODE_W] = true;
+  Input_Sample(input, keys, SDL_SCANCODE_COUNT);
+  ck_assert(Input_IsPressed(input, ACTION_MOVE_FORWARD));
+  ck_assert(Input_IsHeld(input, ACTION_MOVE_FORWARD));
+  ck_assert(!Input_IsHeld(input, ACTION_MENU_OK));
+  ck_assert_uint_eq(Input_GetHoldCount(input, ACTION_MOVE_FORWARD), 1);
+
+  // Switching to another key of the same action keeps it held
+  keys[SDL_SCANCODE_W] = false;
+  keys[SDL_SCANCODE_UP] = true;
+  keys[SDL_SCANCODE_SPACE] = true;
+  Input_Sample(input, keys, SDL_SCANCODE_COUNT);
+  ck_assert(!Input_IsPressed(input, ACTION_MOVE_FORWARD));
+  ck_assert(Input_IsHeld(input, ACTION_MOVE_FORWARD));
+  ck_assert_uint_eq(Input_GetHoldCount(input, ACTION_MOVE_FORWARD), 2);
+  ck_assert_uint_eq(Input_GetPressed(input), BINDINGS_ACTION(ACTION_MENU_OK));
+
+  keys[SDL_SCANCODE_UP] = false;
+  Input_Sample(input, keys, SDL_SCANCODE_COUNT);
+  ck_assert(Input_IsReleased(input, ACTION_MOVE_FORWARD));
+  ck_assert(!Input_IsHeld(input, ACTION_MOVE_FORWARD));
+  ck_assert_uint_eq(Input_GetHoldCount(input, ACTION_MOVE_FORWARD), 0);
+  ck_assert_uint_eq(Input_GetHoldCount(input, ACTION_MENU_OK), 2);
+
+  Input_Sample(input, keys, SDL_SCANCODE_COUNT);
+  ck_assert_uint_eq(Input_GetReleased(input), 0);
+
+  Input_Free(input);
+  Bindings_Free(bindings);
+}
+END_TEST
+
+START_TEST(sample_aliases) {
+  Bindings *bindings = Bindings_Create();
+  Bindings_Set(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_W);
+  Bindings_SetAlias(bindings, ACTION_MENU_UP, ACTION_MOVE_FORWARD);
+  Input *input = Input_Create(bindings);
+  bool keys[SDL_SCANCODE_COUNT] = {false};
+
+  keys[SDL_SCANCODE_W] = true;
+  Input_Sample(input, keys, SDL_SCANCODE_COUNT);
+  ck_assert_uint_eq(Input_GetHeld(input),
+                    BINDINGS_ACTION(ACTION_MOVE_FORWARD) |
+                        BINDINGS_ACTION(ACTION_MENU_UP));
+  ck_assert(!Input_IsHeld(input, (Action)BINDINGS_MAX_ACTIONS));
+
+  Input_Free(input);
+  Bindings_Free(bindings);
+}
+END_TEST
+
+Suite *makeInputSuite(void) {
+  Suite *suite = suite_create("Input");
+  TCase *tc_core = tcase_create("Sampling");
+  suite_add_tcase(suite, tc_core);
+
+  tcase_add_test(tc_core, sample_actions);
+  tcase_add_test(tc_core, sample_aliases);
+
+  return suite;
+}
@@ -184,6 +184,219 @@ START_TEST(clearAll) {
 }
 END_TEST
 
+START_TEST(typed) {
+  Options *options = Options_Create();
+  PairInt fallback = {-1, -1};
+  PairInt size = Options_GetPairInt(options, OPTION_WINDOWSIZE, fallback);
+  ck_assert_int_eq(size.first, -1);
+  ck_assert_int_eq(Options_GetInt(options, (OptionName)OPTION_TEST, 3), 3);
+
+  Options_SetPairInt(options, OPTION_WINDOWSIZE, (PairInt){640, 480});
+  Options_SetInt(options, (OptionName)OPTION_TEST, 7);
+  size = Options_GetPairInt(options, OPTION_WINDOWSIZE, fallback);
+  ck_assert_int_eq(size.first, 640);
+  ck_assert_int_eq(size.second, 480);
+  ck_assert_int_eq(Options_GetInt(options, (OptionName)OPTION_TEST, 3), 7);
+  // The size must match the type
+  ck_assert(Options_GetBool(options, (OptionName)OPTION_TEST, true));
+
+  Options_SetFloat(options, (OptionName)OPTION_TEST, 2.5f);
+  ck_assert_float_eq(
+      Options_GetFloat(options, (OptionName)OPTION_TEST, 0.f), 2.5f);
+  Options_SetBool(options, (OptionName)OPTION_TEST, false);
+  ck_assert(!Options_GetBool(options, (OptionName)OPTION_TEST, true));
+
+  Options_Free(options);
+}
+END_TEST
+
+START_TEST(many_custom) {
+  Options *options = Options_Create();
+  double big[4] = {1., 2., 3., 4.};
+  for (int i = 0; i < 100; i++) {
+    Options_SetInt(options, (OptionName)(OPTION_TEST + i), i);
+  }
+  Options_Set(options, (OptionName)(OPTION_TEST + 100), big, sizeof(big));
+
+  // The values survive the growth of the options
+  for (int i = 0; i < 100; i++) {
+    OptionName name = (OptionName)(OPTION_TEST + i);
+    ck_assert_int_eq(Options_GetInt(options, name, -1), i);
+    ck_assert_int_eq(*(int *)Options_Get(options, name), i);
+  }
+  double *stored = Options_Get(options, (OptionName)(OPTION_TEST + 100));
+  ck_assert_double_eq(stored[3], 4.);
+  ck_assert(!Options_Has(options, (OptionName)(OPTION_TEST + 101)));
+
+  // Setting an option to its own value
+  Options_Set(options, (OptionName)(OPTION_TEST + 100), stored, sizeof(big));
+  stored = Options_Get(options, (OptionName)(OPTION_TEST + 100));
+  ck_assert_double_eq(stored[0], 1.);
+
+  Options_Free(options);
+}
+END_TEST
+
+START_TEST(save_load) {
+  const char *path = "Options_save_load.bin";
+  Options *options = Options_Create();
+  PairInt windowSize = {640, 480};
+  double value = 7.5;
+  Options_Set(options, OPTION_WINDOWSIZE, &windowSize, sizeof(PairInt));
+  Options_SetNoCopy(options, (OptionName)OPTION_TEST, &value);
+  Bindings *bindings = Options_GetBindings(options);
+  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_W);
+  Bindings_Add(bindings, ACTION_MOVE_FORWARD, SDL_SCANCODE_UP);
+  Bindings_SetAlias(bindings, ACTION_MENU_UP, ACTION_MOVE_FORWARD);
+  ck_assert(Options_Save(options, path));
+  Options_Free(options);
+
+  options = Options_Create();
+  bindings = Options_GetBindings(options);
+  Bindings_Set(bindings, ACTION_MENU_OK, SDL_SCANCODE_RETURN);
+  ck_assert(Options_Load(options, path));
+  PairInt *loaded = Options_Get(options, OPTION_WINDOWSIZE);
+  ck_assert_ptr_nonnull(loaded);
+  ck_assert_int_eq(loaded->first, 640);
+  ck_assert_int_eq(loaded->second, 480);
+  // Values that are not copied are not saved
+  ck_assert(!Options_Has(options, (OptionName)OPTION_TEST));
+  // The bindings are replaced
+  ck_assert(!Bindings_Has(bindings, ACTION_MENU_OK));
+  SDL_Scancode codes[BINDINGS_MAX_SCANCODES];
+  ck_assert_uint_eq(Bindings_GetInto(bindings,
+                                     ACTION_MOVE_FORWARD,
+                                     codes,
+                                     BINDINGS_MAX_SCANCODES),
+                    2);
+  ck_assert_int_eq(codes[0], SDL_SCANCODE_W);
+  ck_assert_int_eq(codes[1], SDL_SCANCODE_UP);
+  ck_assert(Bindings_Matches(bindings, ACTION_MENU_UP, SDL_SCANCODE_UP));
+
+  const char *textPath = "Options_save_load.txt";
+  ck_assert(Options_Export(options, textPath));
+  char *text = SDL_LoadFile(textPath, nullptr);
+  ck_assert_ptr_nonnull(SDL_strstr(text, "MENU_UP: MOVE_FORWARD"));
+  SDL_free(text);
+
+  Options_Free(options);
+  SDL_RemovePath(textPath);
+  SDL_RemovePath(path);
+}
+END_TEST
+
+START_TEST(load_invalid) {
+  const char *path = "Options_load_invalid.bin";
+  Options *options = Options_Create();
+  ck_assert(!Options_Load(options, path));
+
+  PairInt windowSize = {640, 480};
+  Options_Set(options, OPTION_WINDOWSIZE, &windowSize, sizeof(PairInt));
+  Bindings_Set(
+      Options_GetBindings(options), ACTION_MOVE_FORWARD, SDL_SCANCODE_W);
+  ck_assert(Options_Save(options, path));
+
+  // Truncate the file in the middle of the bindings
+  size_t size;
+  void *data = SDL_LoadFile(path, &size);
+  ck_assert(SDL_SaveFile(path, data, size - 1));
+  SDL_free(data);
+
+  Options *loaded = Options_Create();
+  ck_assert(!Options_Load(loaded, path));
+  ck_assert(!Options_Has(loaded, OPTION_WINDOWSIZE));
+  ck_assert(!Bindings_Has(Options_GetBindings(loaded), ACTION_MOVE_FORWARD));
+
+  Options_Free(loaded);
+  Options_Free(options);
+  SDL_RemovePath(path);
+}
+END_TEST
+
+typedef struct {
+  int calls;
+  OptionName last;
+  // Whether the observer removes itself when called
+  bool once;
+} Observed;
+
+static void observe(OptionName name, Options *options, void *userdata) {
+  Observed *observed = userdata;
+  observed->calls++;
+  observed->last = name;
+  if (observed->once) {
+    Options_Unobserve(options, name, observe, userdata);
+  }
+}
+
+static void setTest(OptionName, Options *options, void *) {
+  Options_SetInt(options, (OptionName)OPTION_TEST, 1);
+}
+
+START_TEST(observe_batched) {
+  Options *options = Options_Create();
+  Observed size = {};
+  Observed test = {};
+  Options_Observe(options, OPTION_WINDOWSIZE, observe, &size);
+  Options_Observe(options, (OptionName)OPTION_TEST, observe, &test);
+
+  // Nothing changed
+  Options_Flush(options);
+  ck_assert_int_eq(size.calls, 0);
+
+  Options_SetPairInt(options, OPTION_WINDOWSIZE, (PairInt){640, 480});
+  Options_SetPairInt(options, OPTION_WINDOWSIZE, (PairInt){800, 600});
+  ck_assert_int_eq(size.calls, 0);
+  Options_Flush(options);
+  ck_assert_int_eq(size.calls, 1);
+  ck_assert_int_eq(size.last, OPTION_WINDOWSIZE);
+  ck_assert_int_eq(test.calls, 0);
+  Options_Flush(options);
+  ck_assert_int_eq(size.calls, 1);
+
+  Options_Clear(options, OPTION_WINDOWSIZE);
+  Options_Clear(options, (OptionName)OPTION_TEST);
+  Options_Flush(options);
+  ck_assert_int_eq(size.calls, 2);
+  // Clearing an option that is not set does not change it
+  ck_assert_int_eq(test.calls, 0);
+
+  Options_Unobserve(options, OPTION_WINDOWSIZE, observe, &size);
+  Options_SetPairInt(options, OPTION_WINDOWSIZE, (PairInt){640, 480});
+  Options_Flush(options);
+  ck_assert_int_eq(size.calls, 2);
+
+  Options_Free(options);
+}
+END_TEST
+
+START_TEST(observe_during_flush) {
+  Options *options = Options_Create();
+  Observed once = {.once = true};
+  Observed test = {};
+  Options_Observe(options, OPTION_WINDOWSIZE, observe, &once);
+  Options_Observe(options, OPTION_WINDOWSIZE, setTest, nullptr);
+  Options_Observe(options, (OptionName)OPTION_TEST, observe, &test);
+
+  Options_SetPairInt(options, OPTION_WINDOWSIZE, (PairInt){640, 480});
+  Options_Flush(options);
+  ck_assert_int_eq(once.calls, 1);
+  // The changes made by an observer wait for the next flush
+  ck_assert_int_eq(test.calls, 0);
+  Options_Flush(options);
+  ck_assert_int_eq(test.calls, 1);
+
+  // The first observer removed itself, the others are still there
+  Options_SetPairInt(options, OPTION_WINDOWSIZE, (PairInt){800, 600});
+  Options_Flush(options);
+  Options_Flush(options);
+  ck_assert_int_eq(once.calls, 1);
+  ck_assert_int_eq(test.calls, 2);
+
+  Options_Free(options);
+}
+END_TEST
+
 Suite *makeOptionsSuite() {
   Suite *suite = suite_create("Options");
   TCase *tc_core = tcase_create("Data structure");
@@ -195,6 +408,20 @@ Suite *makeOptionsSuite() {
   tcase_add_test(tc_core, setWithDestroy_get);
   tcase_add_test(tc_core, clear);
   tcase_add_test(tc_core, clearAll);
+  tcase_add_test(tc_core, typed);
+  tcase_add_test(tc_core, many_custom);
+
+  TCase *tc_files = tcase_create("Files");
+  suite_add_tcase(suite, tc_files);
+
+  tcase_add_test(tc_files, save_load);
+  tcase_add_test(tc_files, load_invalid);
+
+  TCase *tc_observers = tcase_create("Observers");
+  suite_add_tcase(suite, tc_observers);
+
+  tcase_add_test(tc_observers, observe_batched);
+  tcase_add_test(tc_observers, observe_during_flush);
 
   return suite;
 }
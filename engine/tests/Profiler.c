@@ -0,0 +1,114 @@
+/* Small game engine in C.
+  Copyright (C) 2025 Gaëtan Staquet <gaetan.staquet@gmail.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Engine/Profiler.h"
+#include "Engine/StateManager.h"
+#include "EngineTest.h"
+#include <check.h>
+
+START_TEST(unknown_state) {
+  Profiler *profiler = Profiler_Create();
+  ProfilerStats stats;
+  ck_assert(!Profiler_GetStats(profiler, "Game", PROFILER_UPDATE, &stats));
+
+  Profiler_Record(profiler, "Game", PROFILER_UPDATE, 10);
+  ck_assert(!Profiler_GetStats(profiler, "Menu", PROFILER_UPDATE, &stats));
+  ck_assert(!Profiler_GetStats(profiler, "Game", PROFILER_RENDER, &stats));
+
+  Profiler_Free(profiler);
+}
+END_TEST
+
+START_TEST(min_avg_p99) {
+  Profiler *profiler = Profiler_Create();
+  for (Uint64 i = 100; i >= 1; i--) {
+    Profiler_Record(profiler, "Game", PROFILER_RENDER, i);
+  }
+
+  ProfilerStats stats;
+  ck_assert(Profiler_GetStats(profiler, "Game", PROFILER_RENDER, &stats));
+  ck_assert_uint_eq(stats.samples, 100);
+  ck_assert_uint_eq(stats.minNS, 1);
+  ck_assert_uint_eq(stats.avgNS, 50);
+  ck_assert_uint_eq(stats.p99NS, 99);
+
+  Profiler_Free(profiler);
+}
+END_TEST
+
+START_TEST(rolling_window) {
+  Profiler *profiler = Profiler_Create();
+  for (unsigned int i = 0; i < PROFILER_WINDOW; i++) {
+    Profiler_Record(profiler, "Game", PROFILER_UPDATE, 1000);
+  }
+  // The old samples are replaced one by one
+  for (unsigned int i = 0; i < PROFILER_WINDOW; i++) {
+    Profiler_Record(profiler, "Game", PROFILER_UPDATE, 10);
+  }
+
+  ProfilerStats stats;
+  ck_assert(Profiler_GetStats(profiler, "Game", PROFILER_UPDATE, &stats));
+  ck_assert_uint_eq(stats.samples, PROFILER_WINDOW);
+  ck_assert_uint_eq(stats.minNS, 10);
+  ck_assert_uint_eq(stats.avgNS, 10);
+  ck_assert_uint_eq(stats.p99NS, 10);
+
+  Profiler_Reset(profiler);
+  ck_assert(!Profiler_GetStats(profiler, "Game", PROFILER_UPDATE, &stats));
+
+  Profiler_Free(profiler);
+}
+END_TEST
+
+static bool update(void *, Uint64, StateManager *) {
+  return false;
+}
+
+static const StateClass gameClass = {
+    .name = "Game",
+    .update = update,
+};
+
+START_TEST(state_manager_records) {
+  StateManager *manager = StateManager_Create(1, nullptr, nullptr);
+  State *state = State_Create(&gameClass);
+  StateManager_Push(manager, state);
+  StateManager_Update(manager, 10);
+
+  // Only measured when the engine is compiled with ENGINE_PROFILING
+  if (manager->profiler != nullptr) {
+    ProfilerStats stats;
+    ck_assert(
+        Profiler_GetStats(manager->profiler, "Game", PROFILER_UPDATE, &stats));
+    ck_assert_uint_eq(stats.samples, 1);
+  }
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+Suite *makeProfilerSuite(void) {
+  Suite *suite = suite_create("Profiler");
+  TCase *tc_core = tcase_create("Core");
+  suite_add_tcase(suite, tc_core);
+
+  tcase_add_test(tc_core, unknown_state);
+  tcase_add_test(tc_core, min_avg_p99);
+  tcase_add_test(tc_core, rolling_window);
+  tcase_add_test(tc_core, state_manager_records);
+
+  return suite;
+}
@@ -18,8 +18,11 @@
 #include "EngineTest.h"
 #include "SDL3/SDL_stdinc.h"
 #include <check.h>
+#include <stddef.h>
 #include <stdlib.h>
 
+static const StateClass emptyClass = {.name = "Empty"};
+
 START_TEST(create_and_free) {
   StateManager *manager = StateManager_Create(3, nullptr, nullptr);
   ck_assert_ptr_nonnull(manager);
@@ -48,7 +51,7 @@ START_TEST(push_1) {
   StateManager *manager = StateManager_Create(2, nullptr, nullptr);
   ck_assert_ptr_nonnull(manager);
 
-  State *s1 = State_Create();
+  State *s1 = State_Create(&emptyClass);
   ck_assert_int_eq(StateManager_Push(manager, s1), STATEMANAGER_OK);
   ck_assert_int_eq(manager->top, 0);
 
@@ -60,8 +63,8 @@ START_TEST(push_2) {
   StateManager *manager = StateManager_Create(3, nullptr, nullptr);
   ck_assert_ptr_nonnull(manager);
 
-  State *s1 = State_Create();
-  State *s2 = State_Create();
+  State *s1 = State_Create(&emptyClass);
+  State *s2 = State_Create(&emptyClass);
   ck_assert_int_eq(StateManager_Push(manager, s1), STATEMANAGER_OK);
   ck_assert_int_eq(manager->top, 0);
   ck_assert_int_eq(StateManager_Push(manager, s2), STATEMANAGER_OK);
@@ -75,9 +78,9 @@ START_TEST(push_3) {
   StateManager *manager = StateManager_Create(3, nullptr, nullptr);
   ck_assert_ptr_nonnull(manager);
 
-  State *s1 = State_Create();
-  State *s2 = State_Create();
-  State *s3 = State_Create();
+  State *s1 = State_Create(&emptyClass);
+  State *s2 = State_Create(&emptyClass);
+  State *s3 = State_Create(&emptyClass);
   ck_assert_int_eq(StateManager_Push(manager, s1), STATEMANAGER_OK);
   ck_assert_int_eq(manager->top, 0);
   ck_assert_int_eq(StateManager_Push(manager, s2), STATEMANAGER_OK);
@@ -93,15 +96,19 @@ START_TEST(push_exceeds_capacity) {
   StateManager *manager = StateManager_Create(2, nullptr, nullptr);
   ck_assert_ptr_nonnull(manager);
 
-  State *s1 = State_Create();
-  State *s2 = State_Create();
-  State *s3 = State_Create();
+  State *s1 = State_Create(&emptyClass);
+  State *s2 = State_Create(&emptyClass);
+  State *s3 = State_Create(&emptyClass);
   ck_assert_int_eq(StateManager_Push(manager, s1), STATEMANAGER_OK);
   ck_assert_int_eq(manager->top, 0);
   ck_assert_int_eq(StateManager_Push(manager, s2), STATEMANAGER_OK);
   ck_assert_int_eq(manager->top, 1);
-  ck_assert_int_eq(StateManager_Push(manager, s3), STATEMANAGER_FULL);
-  ck_assert_int_eq(manager->top, 1);
+  // The stack grows
+  ck_assert_int_eq(StateManager_Push(manager, s3), STATEMANAGER_OK);
+  ck_assert_int_eq(manager->top, 2);
+  ck_assert_int_eq(manager->capacity, 4);
+  ck_assert_ptr_eq(manager->states[0], s1);
+  ck_assert_ptr_eq(manager->states[2], s3);
 
   StateManager_Free(manager);
 }
@@ -111,7 +118,7 @@ START_TEST(push_pop_1) {
   StateManager *manager = StateManager_Create(3, nullptr, nullptr);
   ck_assert_ptr_nonnull(manager);
 
-  State *s1 = State_Create();
+  State *s1 = State_Create(&emptyClass);
   ck_assert_int_eq(StateManager_Push(manager, s1), STATEMANAGER_OK);
   ck_assert_int_eq(manager->top, 0);
   ck_assert_int_eq(StateManager_Pop(manager), STATEMANAGER_OK);
@@ -125,9 +132,9 @@ START_TEST(push_pop_2) {
   StateManager *manager = StateManager_Create(3, nullptr, nullptr);
   ck_assert_ptr_nonnull(manager);
 
-  State *s1 = State_Create();
-  State *s2 = State_Create();
-  State *s3 = State_Create();
+  State *s1 = State_Create(&emptyClass);
+  State *s2 = State_Create(&emptyClass);
+  State *s3 = State_Create(&emptyClass);
   ck_assert_int_eq(StateManager_Push(manager, s1), STATEMANAGER_OK);
   ck_assert_int_eq(manager->top, 0);
   ck_assert_int_eq(StateManager_Push(manager, s2), STATEMANAGER_OK);
@@ -170,11 +177,29 @@ static bool update_state_no_passthrough(void *memory, Uint64, StateManager *) {
   return false;
 }
 
+static const StateClass memoryClass = {
+    .name = "Memory",
+    .init = init_state,
+    .destroy = destroy_state,
+};
+
+static const StateClass passthroughClass = {
+    .name = "Passthrough",
+    .init = init_state,
+    .destroy = destroy_state,
+    .update = update_state_passthrough,
+};
+
+static const StateClass noPassthroughClass = {
+    .name = "No passthrough",
+    .init = init_state,
+    .destroy = destroy_state,
+    .update = update_state_no_passthrough,
+};
+
 START_TEST(init_destroy_memory) {
   StateManager *manager = StateManager_Create(1, nullptr, nullptr);
-  State *state = State_Create();
-  State_SetInit(state, init_state);
-  State_SetDestroy(state, destroy_state);
+  State *state = State_Create(&memoryClass);
 
   StateManager_Push(manager, state);
   Memory *m = State_GetMemory(state);
@@ -186,15 +211,8 @@ END_TEST
 
 START_TEST(update_passthrough) {
   StateManager *manager = StateManager_Create(2, nullptr, nullptr);
-  State *bottom = State_Create();
-  State *top = State_Create();
-
-  State_SetInit(bottom, init_state);
-  State_SetInit(top, init_state);
-  State_SetDestroy(bottom, destroy_state);
-  State_SetDestroy(top, destroy_state);
-  State_SetUpdate(bottom, update_state_passthrough);
-  State_SetUpdate(top, update_state_passthrough);
+  State *bottom = State_Create(&passthroughClass);
+  State *top = State_Create(&passthroughClass);
 
   StateManager_Push(manager, bottom);
   StateManager_Push(manager, top);
@@ -213,15 +231,8 @@ END_TEST
 
 START_TEST(update_no_passthrough) {
   StateManager *manager = StateManager_Create(2, nullptr, nullptr);
-  State *bottom = State_Create();
-  State *top = State_Create();
-
-  State_SetInit(bottom, init_state);
-  State_SetInit(top, init_state);
-  State_SetDestroy(bottom, destroy_state);
-  State_SetDestroy(top, destroy_state);
-  State_SetUpdate(bottom, update_state_no_passthrough);
-  State_SetUpdate(top, update_state_no_passthrough);
+  State *bottom = State_Create(&noPassthroughClass);
+  State *top = State_Create(&noPassthroughClass);
 
   StateManager_Push(manager, bottom);
   StateManager_Push(manager, top);
@@ -238,6 +249,655 @@ START_TEST(update_no_passthrough) {
 }
 END_TEST
 
+START_TEST(class_defaults) {
+  const StateClass *resolved = StateClass_Register(&emptyClass);
+  ck_assert_ptr_nonnull(resolved);
+  ck_assert_ptr_eq(StateClass_Register(&emptyClass), resolved);
+  ck_assert_ptr_eq(StateClass_Register(resolved), resolved);
+  ck_assert_ptr_nonnull(resolved->update);
+  ck_assert_ptr_nonnull(resolved->render);
+  ck_assert(!resolved->isTransparent(nullptr));
+
+  StateManager *manager = StateManager_Create(2, nullptr, nullptr);
+  State *bottom = State_Create(&passthroughClass);
+  State *top = State_Create(&emptyClass);
+  ck_assert_ptr_eq(top->stateClass, resolved);
+  StateManager_Push(manager, bottom);
+  StateManager_Push(manager, top);
+
+  // The default update function stops the propagation
+  StateManager_Update(manager, 0);
+  ck_assert_int_eq(((Memory *)State_GetMemory(bottom))->n, 5);
+  StateManager_Render(manager, nullptr);
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+typedef struct {
+  unsigned int ticks;
+  Uint64 elapsed;
+  float alpha;
+} Clock;
+
+static void init_clock(void **memory, StateManager *) {
+  Clock *clock = malloc(sizeof(Clock));
+  clock->ticks = 0;
+  clock->elapsed = 0;
+  clock->alpha = -1;
+  *memory = clock;
+}
+
+static bool update_clock(void *memory, Uint64 delta, StateManager *) {
+  Clock *clock = memory;
+  clock->ticks++;
+  clock->elapsed += delta;
+  return true;
+}
+
+static void render_clock(void *memory, SDL_Renderer *, float alpha) {
+  ((Clock *)memory)->alpha = alpha;
+}
+
+static const StateClass clockClass = {
+    .name = "Clock",
+    .init = init_clock,
+    .destroy = destroy_state,
+    .update = update_clock,
+    .render = render_clock,
+};
+
+static State *createClockState() {
+  return State_Create(&clockClass);
+}
+
+START_TEST(advance_fixed_step) {
+  StateManager *manager = StateManager_Create(1, nullptr, nullptr);
+  State *state = createClockState();
+  StateManager_Push(manager, state);
+  StateManager_SetFixedStep(manager, 10, 5);
+  Clock *clock = State_GetMemory(state);
+
+  ck_assert_uint_eq(StateManager_Advance(manager, SDL_MS_TO_NS(25)), 2);
+  ck_assert_uint_eq(clock->ticks, 2);
+  ck_assert_uint_eq(clock->elapsed, 20);
+  ck_assert_float_eq_tol(manager->alpha, 0.5, 1e-6);
+
+  ck_assert_uint_eq(StateManager_Advance(manager, SDL_MS_TO_NS(4)), 0);
+  ck_assert_uint_eq(clock->ticks, 2);
+  ck_assert_float_eq_tol(manager->alpha, 0.9, 1e-6);
+
+  // The remainders are kept: 5ms and 0.5ms do not get lost
+  ck_assert_uint_eq(StateManager_Advance(manager, 1500000), 1);
+  ck_assert_uint_eq(clock->ticks, 3);
+  ck_assert_uint_eq(clock->elapsed, 30);
+  ck_assert_float_eq_tol(manager->alpha, 0.05, 1e-6);
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+START_TEST(advance_caps_steps) {
+  StateManager *manager = StateManager_Create(1, nullptr, nullptr);
+  State *state = createClockState();
+  StateManager_Push(manager, state);
+  StateManager_SetFixedStep(manager, 10, 3);
+  Clock *clock = State_GetMemory(state);
+
+  ck_assert_uint_eq(StateManager_Advance(manager, SDL_MS_TO_NS(1005)), 3);
+  ck_assert_uint_eq(clock->ticks, 3);
+  ck_assert_float_eq_tol(manager->alpha, 0.5, 1e-6);
+
+  // The time that could not be simulated is dropped
+  ck_assert_uint_eq(StateManager_Advance(manager, SDL_MS_TO_NS(5)), 1);
+  ck_assert_uint_eq(clock->ticks, 4);
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+static void countChanges(OptionName, Options *, void *userdata) {
+  (*(int *)userdata)++;
+}
+
+START_TEST(advance_flushes_options) {
+  Options *options = Options_Create();
+  StateManager *manager = StateManager_Create(1, nullptr, options);
+  int changes = 0;
+  Options_Observe(options, OPTION_WINDOWSIZE, countChanges, &changes);
+
+  Options_SetPairInt(options, OPTION_WINDOWSIZE, (PairInt){640, 480});
+  Options_SetPairInt(options, OPTION_WINDOWSIZE, (PairInt){800, 600});
+  ck_assert_int_eq(changes, 0);
+  StateManager_Advance(manager, 0);
+  ck_assert_int_eq(changes, 1);
+  StateManager_Advance(manager, 0);
+  ck_assert_int_eq(changes, 1);
+
+  StateManager_Free(manager);
+  Options_Free(options);
+}
+END_TEST
+
+START_TEST(render_alpha) {
+  StateManager *manager = StateManager_Create(1, nullptr, nullptr);
+  State *state = createClockState();
+  StateManager_Push(manager, state);
+  Clock *clock = State_GetMemory(state);
+
+  StateManager_Advance(manager,
+                       SDL_MS_TO_NS(STATEMANAGER_DEFAULT_TICK_MS) * 5 / 4);
+  StateManager_Render(manager, nullptr);
+  ck_assert_float_eq_tol(clock->alpha, 0.25, 1e-6);
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+static unsigned int initialized = 0;
+
+static void init_counted(void **memory, StateManager *manager) {
+  initialized++;
+  init_state(memory, manager);
+}
+
+static const StateClass countedClass = {
+    .name = "Counted",
+    .init = init_counted,
+    .destroy = destroy_state,
+};
+
+static bool process_replace(void *, SDL_Event *, StateManager *manager) {
+  State *next = State_Create(&countedClass);
+
+  ck_assert_int_eq(StateManager_Pop(manager), STATEMANAGER_OK);
+  ck_assert_int_eq(StateManager_Push(manager, next), STATEMANAGER_OK);
+  // Nothing changes while the manager is dispatching the event
+  ck_assert_int_eq(manager->top, 1);
+  ck_assert_uint_eq(initialized, 0);
+  return true;
+}
+
+static bool process_push_pop(void *, SDL_Event *, StateManager *manager) {
+  State *next = State_Create(&countedClass);
+
+  ck_assert_int_eq(StateManager_Push(manager, next), STATEMANAGER_OK);
+  ck_assert_int_eq(StateManager_Pop(manager), STATEMANAGER_OK);
+  ck_assert_uint_eq(manager->pendingTransitions, 0);
+  return false;
+}
+
+static bool process_pop_twice(void *, SDL_Event *, StateManager *manager) {
+  ck_assert_int_eq(StateManager_Pop(manager), STATEMANAGER_OK);
+  ck_assert_int_eq(StateManager_Pop(manager), STATEMANAGER_EMPTY);
+  return false;
+}
+
+static const StateClass replaceClass = {
+    .name = "Replace",
+    .processEvent = process_replace,
+};
+
+static const StateClass pushPopClass = {
+    .name = "Push pop",
+    .processEvent = process_push_pop,
+};
+
+static const StateClass popTwiceClass = {
+    .name = "Pop twice",
+    .processEvent = process_pop_twice,
+};
+
+START_TEST(deferred_transitions) {
+  StateManager *manager = StateManager_Create(3, nullptr, nullptr);
+  State *bottom = State_Create(&emptyClass);
+  State *top = State_Create(&replaceClass);
+  StateManager_Push(manager, bottom);
+  StateManager_Push(manager, top);
+
+  initialized = 0;
+  SDL_Event event = {.type = SDL_EVENT_KEY_DOWN};
+  StateManager_ProcessEvent(manager, &event);
+
+  ck_assert_int_eq(manager->top, 1);
+  ck_assert_uint_eq(initialized, 1);
+  ck_assert_ptr_eq(manager->states[0], bottom);
+  ck_assert_ptr_ne(manager->states[1], top);
+  ck_assert_int_eq(((Memory *)State_GetMemory(manager->states[1]))->n, 5);
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+START_TEST(deferred_push_pop_cancel) {
+  StateManager *manager = StateManager_Create(2, nullptr, nullptr);
+  State *state = State_Create(&pushPopClass);
+  StateManager_Push(manager, state);
+
+  initialized = 0;
+  SDL_Event event = {.type = SDL_EVENT_KEY_DOWN};
+  StateManager_ProcessEvent(manager, &event);
+
+  ck_assert_int_eq(manager->top, 0);
+  ck_assert_ptr_eq(manager->states[0], state);
+  ck_assert_uint_eq(initialized, 0);
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+START_TEST(deferred_pop_empty) {
+  StateManager *manager = StateManager_Create(2, nullptr, nullptr);
+  State *state = State_Create(&popTwiceClass);
+  StateManager_Push(manager, state);
+
+  SDL_Event event = {.type = SDL_EVENT_KEY_DOWN};
+  StateManager_ProcessEvent(manager, &event);
+  ck_assert_int_eq(manager->top, -1);
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+static unsigned int loaded = 0;
+static unsigned int destroyed = 0;
+
+static void load_state(void **memory, StateManager *manager) {
+  loaded++;
+  init_state(memory, manager);
+}
+
+static void init_loaded(void **memory, StateManager *) {
+  // The memory was set by the load function
+  ck_assert_ptr_nonnull(*memory);
+  ((Memory *)*memory)->n++;
+}
+
+static void destroy_counted(void *memory) {
+  destroyed++;
+  destroy_state(memory);
+}
+
+static const StateClass loadedClass = {
+    .name = "Loaded",
+    .load = load_state,
+    .init = init_loaded,
+    .destroy = destroy_counted,
+};
+
+static State *createLoadedState(void) {
+  return State_Create(&loadedClass);
+}
+
+START_TEST(preload_then_push) {
+  StateManager *manager = StateManager_Create(1, nullptr, nullptr);
+  State *state = createLoadedState();
+
+  loaded = 0;
+  ck_assert_int_eq(StateManager_Preload(manager, state), STATEMANAGER_OK);
+  ck_assert_int_eq(StateManager_Push(manager, state), STATEMANAGER_OK);
+  ck_assert_uint_eq(loaded, 1);
+  ck_assert_int_eq(((Memory *)State_GetMemory(state))->n, 6);
+
+  // Preloading a state that is already loaded does nothing
+  ck_assert_int_eq(StateManager_Preload(manager, state), STATEMANAGER_OK);
+  ck_assert_uint_eq(loaded, 1);
+  ck_assert_int_eq(StateManager_Preload(manager, nullptr),
+                   STATEMANAGER_STATE_NULL);
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+START_TEST(push_loads_synchronously) {
+  StateManager *manager = StateManager_Create(1, nullptr, nullptr);
+  State *state = createLoadedState();
+
+  loaded = 0;
+  ck_assert_int_eq(StateManager_Push(manager, state), STATEMANAGER_OK);
+  ck_assert_uint_eq(loaded, 1);
+  ck_assert_int_eq(((Memory *)State_GetMemory(state))->n, 6);
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+static const StateClass keptClass = {
+    .name = "Kept",
+    .load = load_state,
+    .init = init_loaded,
+    .destroy = destroy_counted,
+    .keepAlive = true,
+};
+
+START_TEST(keep_alive) {
+  StateManager *manager = StateManager_Create(2, nullptr, nullptr);
+  State *state = StateManager_Acquire(manager, &keptClass);
+  ck_assert_ptr_nonnull(state);
+
+  loaded = destroyed = 0;
+  StateManager_Push(manager, state);
+  StateManager_Pop(manager);
+  ck_assert_uint_eq(destroyed, 0);
+  ck_assert_ptr_eq(manager->dormant, state);
+
+  // The dormant state comes back as it was
+  ck_assert_ptr_eq(StateManager_Acquire(manager, &keptClass), state);
+  ck_assert_ptr_null(manager->dormant);
+  StateManager_Push(manager, state);
+  ck_assert_uint_eq(loaded, 1);
+  ck_assert_int_eq(((Memory *)State_GetMemory(state))->n, 6);
+
+  // Other classes are not kept
+  StateManager_Push(manager, State_Create(&loadedClass));
+  StateManager_Pop(manager);
+  ck_assert_uint_eq(destroyed, 1);
+  State *other = StateManager_Acquire(manager, &keptClass);
+  ck_assert_ptr_ne(other, state);
+  State_Free(other);
+
+  StateManager_Pop(manager);
+  StateManager_Free(manager);
+  ck_assert_uint_eq(destroyed, 2);
+}
+END_TEST
+
+START_TEST(free_preloaded) {
+  StateManager *manager = StateManager_Create(1, nullptr, nullptr);
+  State *state = createLoadedState();
+
+  destroyed = 0;
+  ck_assert_int_eq(StateManager_Preload(manager, state), STATEMANAGER_OK);
+  State_Free(state);
+  ck_assert_uint_eq(destroyed, 1);
+
+  // A state that was never loaded has no memory to destroy
+  State_Free(createLoadedState());
+  ck_assert_uint_eq(destroyed, 1);
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+static unsigned int rendered = 0;
+
+static void render_counted(void *, SDL_Renderer *, float) {
+  rendered++;
+}
+
+static bool transparent(const void *) {
+  return true;
+}
+
+static bool update_passthrough_stateless(void *, Uint64, StateManager *) {
+  return true;
+}
+
+static const StateClass backgroundClass = {
+    .name = "Background",
+    .render = render_counted,
+};
+
+static const StateClass overlayClass = {
+    .name = "Overlay",
+    .isTransparent = transparent,
+    .cacheBelow = true,
+};
+
+static const StateClass passthroughOverlayClass = {
+    .name = "Passthrough overlay",
+    .update = update_passthrough_stateless,
+    .isTransparent = transparent,
+    .cacheBelow = true,
+};
+
+START_TEST(cache_below_overlay) {
+  SDL_Surface *surface = SDL_CreateSurface(64, 48, SDL_PIXELFORMAT_RGBA32);
+  SDL_Renderer *renderer = SDL_CreateSoftwareRenderer(surface);
+  ck_assert_ptr_nonnull(renderer);
+  StateManager *manager = StateManager_Create(3, nullptr, nullptr);
+  StateManager_Push(manager, State_Create(&backgroundClass));
+
+  rendered = 0;
+  StateManager_Render(manager, renderer);
+  StateManager_Render(manager, renderer);
+  ck_assert_uint_eq(rendered, 2);
+
+  StateManager_Push(manager, State_Create(&overlayClass));
+  StateManager_Render(manager, renderer);
+  StateManager_Render(manager, renderer);
+  StateManager_Render(manager, renderer);
+  ck_assert_uint_eq(rendered, 3);
+
+  // The overlay stops the update before it reaches the background
+  StateManager_Update(manager, 10);
+  StateManager_Render(manager, renderer);
+  ck_assert_uint_eq(rendered, 3);
+
+  StateManager_InvalidateCache(manager);
+  StateManager_Render(manager, renderer);
+  ck_assert_uint_eq(rendered, 4);
+
+  StateManager_Pop(manager);
+  StateManager_Render(manager, renderer);
+  ck_assert_uint_eq(rendered, 5);
+
+  // The background is updated under this overlay, so it is rendered again
+  StateManager_Push(manager, State_Create(&passthroughOverlayClass));
+  StateManager_Render(manager, renderer);
+  StateManager_Update(manager, 10);
+  StateManager_Render(manager, renderer);
+  ck_assert_uint_eq(rendered, 7);
+  StateManager_Render(manager, renderer);
+  ck_assert_uint_eq(rendered, 7);
+
+  StateManager_Free(manager);
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroySurface(surface);
+}
+END_TEST
+
+static bool
+process_mark_dirty(void *, SDL_Event *event, StateManager *manager) {
+  if (event->type == SDL_EVENT_KEY_DOWN) {
+    StateManager_MarkDirty(manager);
+  }
+  return false;
+}
+
+static const StateClass menuClass = {
+    .name = "Menu",
+    .processEvent = process_mark_dirty,
+    .renderOnDemand = true,
+};
+
+static const StateClass staticOverlayClass = {
+    .name = "Static overlay",
+    .isTransparent = transparent,
+    .cacheBelow = true,
+    .renderOnDemand = true,
+};
+
+START_TEST(render_on_demand) {
+  StateManager *manager = StateManager_Create(3, nullptr, nullptr);
+  ck_assert(StateManager_NeedsRender(manager));
+  StateManager_ClearDirty(manager);
+  ck_assert(!StateManager_NeedsRender(manager));
+
+  // Pushing a state changes the frame
+  StateManager_Push(manager, State_Create(&menuClass));
+  ck_assert(StateManager_NeedsRender(manager));
+  StateManager_ClearDirty(manager);
+  ck_assert(!StateManager_NeedsRender(manager));
+
+  SDL_Event event = {.type = SDL_EVENT_KEY_UP};
+  StateManager_ProcessEvent(manager, &event);
+  ck_assert(!StateManager_NeedsRender(manager));
+  event.type = SDL_EVENT_KEY_DOWN;
+  StateManager_ProcessEvent(manager, &event);
+  ck_assert(StateManager_NeedsRender(manager));
+  StateManager_ClearDirty(manager);
+
+  event.type = SDL_EVENT_WINDOW_EXPOSED;
+  StateManager_ProcessEvent(manager, &event);
+  ck_assert(StateManager_NeedsRender(manager));
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+START_TEST(render_on_demand_cached) {
+  StateManager *manager = StateManager_Create(3, nullptr, nullptr);
+  StateManager_Push(manager, State_Create(&backgroundClass));
+  StateManager_ClearDirty(manager);
+  // The background is always rendered
+  ck_assert(StateManager_NeedsRender(manager));
+
+  // But not when it is cached below an overlay
+  StateManager_Push(manager, State_Create(&staticOverlayClass));
+  StateManager_ClearDirty(manager);
+  ck_assert(!StateManager_NeedsRender(manager));
+
+  StateManager_Pop(manager);
+  ck_assert(StateManager_NeedsRender(manager));
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+static unsigned int keysProcessed = 0;
+static unsigned int motionsProcessed = 0;
+
+static bool process_count(void *, SDL_Event *event, StateManager *) {
+  if (event->type == SDL_EVENT_KEY_DOWN) {
+    keysProcessed++;
+  } else if (event->type == SDL_EVENT_MOUSE_MOTION) {
+    motionsProcessed++;
+  }
+  return false;
+}
+
+static const StateClass keyboardClass = {
+    .name = "Keyboard",
+    .processEvent = process_count,
+    .events = EVENTMASK(EVENT_CATEGORY_KEY_DOWN),
+};
+
+static const StateClass mouseClass = {
+    .name = "Mouse",
+    .processEvent = process_count,
+    .events = EVENTMASK(EVENT_CATEGORY_MOUSE_MOTION),
+};
+
+START_TEST(route_events) {
+  StateManager *manager = StateManager_Create(3, nullptr, nullptr);
+  StateManager_Push(manager, State_Create(&mouseClass));
+  StateManager_Push(manager, State_Create(&keyboardClass));
+  keysProcessed = motionsProcessed = 0;
+
+  // The keyboard state stops the key, and lets the motion through
+  SDL_Event event = {.type = SDL_EVENT_KEY_DOWN};
+  StateManager_ProcessEvent(manager, &event);
+  event.type = SDL_EVENT_MOUSE_MOTION;
+  StateManager_ProcessEvent(manager, &event);
+  ck_assert_uint_eq(keysProcessed, 1);
+  ck_assert_uint_eq(motionsProcessed, 1);
+
+  // Nobody wants the key ups
+  event.type = SDL_EVENT_KEY_UP;
+  StateManager_ProcessEvent(manager, &event);
+  ck_assert_int_eq(manager->dispatchSizes[EVENT_CATEGORY_KEY_UP], 0);
+
+  // A state that does not declare its events receives all of them, and the
+  // lists follow the stack
+  StateManager_Push(manager, State_Create(&emptyClass));
+  event.type = SDL_EVENT_MOUSE_MOTION;
+  StateManager_ProcessEvent(manager, &event);
+  ck_assert_uint_eq(motionsProcessed, 1);
+  StateManager_Pop(manager);
+  StateManager_ProcessEvent(manager, &event);
+  ck_assert_uint_eq(motionsProcessed, 2);
+
+  StateManager_Free(manager);
+}
+END_TEST
+
+typedef struct {
+  int values[4];
+} Block;
+
+static unsigned int blockValue = 0;
+
+static void init_block(void **memory, StateManager *) {
+  Block *block = *memory;
+  ck_assert_ptr_nonnull(block);
+  ck_assert_int_eq(block->values[3], 0);
+  block->values[3] = 42;
+}
+
+static void destroy_block(void *memory) {
+  blockValue = ((Block *)memory)->values[3];
+}
+
+static const StateClass blockClass = {
+    .name = "Block",
+    .init = init_block,
+    .destroy = destroy_block,
+    .memorySize = sizeof(Block),
+};
+
+START_TEST(recycle_states) {
+  StateManager *manager = StateManager_Create(1, nullptr, nullptr);
+  State *state = State_Create(&blockClass);
+  ck_assert_uint_eq((uintptr_t)State_GetMemory(state) % alignof(max_align_t),
+                    0);
+  StateManager_Push(manager, state);
+  ck_assert_int_eq(((Block *)State_GetMemory(state))->values[3], 42);
+  StateManager_Pop(manager);
+  ck_assert_uint_eq(blockValue, 42);
+
+  // The block is reused, and its memory is cleared
+  State *again = State_Create(&blockClass);
+  ck_assert_ptr_eq(again, state);
+  StateManager_Push(manager, again);
+  ck_assert_int_eq(((Block *)State_GetMemory(again))->values[3], 42);
+
+  // Other classes have their own pool
+  State *other = State_Create(&emptyClass);
+  ck_assert_ptr_ne(other, state);
+  State_Free(other);
+
+  StateManager_Free(manager);
+  StateClass_FreePools();
+}
+END_TEST
+
+static bool process_push(void *, SDL_Event *, StateManager *manager) {
+  ck_assert_int_eq(StateManager_Push(manager, State_Create(&emptyClass)),
+                   STATEMANAGER_OK);
+  return true;
+}
+
+static const StateClass pushClass = {
+    .name = "Push",
+    .processEvent = process_push,
+};
+
+START_TEST(grow_while_dispatching) {
+  StateManager *manager = StateManager_Create(2, nullptr, nullptr);
+  StateManager_Push(manager, State_Create(&pushClass));
+  StateManager_Push(manager, State_Create(&pushClass));
+
+  // Both states push while the stack is full
+  SDL_Event event = {.type = SDL_EVENT_KEY_DOWN};
+  StateManager_ProcessEvent(manager, &event);
+  ck_assert_int_eq(manager->top, 3);
+  ck_assert_int_eq(manager->capacity, 4);
+
+  StateManager_Free(manager);
+}
+END_TEST
+
 Suite *makeStateManagerSuite(void) {
   Suite *suite = suite_create("State manager");
   TCase *tc_core = tcase_create("Stack");
@@ -258,6 +918,52 @@ Suite *makeStateManagerSuite(void) {
   tcase_add_test(tc_state, init_destroy_memory);
   tcase_add_test(tc_state, update_passthrough);
   tcase_add_test(tc_state, update_no_passthrough);
+  tcase_add_test(tc_state, class_defaults);
+
+  TCase *tc_step = tcase_create("Fixed step");
+  suite_add_tcase(suite, tc_step);
+
+  tcase_add_test(tc_step, advance_fixed_step);
+  tcase_add_test(tc_step, advance_caps_steps);
+  tcase_add_test(tc_step, advance_flushes_options);
+  tcase_add_test(tc_step, render_alpha);
+
+  TCase *tc_cache = tcase_create("Layer cache");
+  suite_add_tcase(suite, tc_cache);
+
+  tcase_add_test(tc_cache, cache_below_overlay);
+
+  TCase *tc_demand = tcase_create("On-demand rendering");
+  suite_add_tcase(suite, tc_demand);
+
+  tcase_add_test(tc_demand, render_on_demand);
+  tcase_add_test(tc_demand, render_on_demand_cached);
+
+  TCase *tc_transitions = tcase_create("Deferred transitions");
+  suite_add_tcase(suite, tc_transitions);
+
+  tcase_add_test(tc_transitions, deferred_transitions);
+  tcase_add_test(tc_transitions, deferred_push_pop_cancel);
+  tcase_add_test(tc_transitions, deferred_pop_empty);
+
+  TCase *tc_events = tcase_create("Event routing");
+  suite_add_tcase(suite, tc_events);
+
+  tcase_add_test(tc_events, route_events);
+
+  TCase *tc_preload = tcase_create("Preloading");
+  suite_add_tcase(suite, tc_preload);
+
+  tcase_add_test(tc_preload, preload_then_push);
+  tcase_add_test(tc_preload, push_loads_synchronously);
+  tcase_add_test(tc_preload, free_preloaded);
+  tcase_add_test(tc_preload, keep_alive);
+
+  TCase *tc_pool = tcase_create("Allocations");
+  suite_add_tcase(suite, tc_pool);
+
+  tcase_add_test(tc_pool, recycle_states);
+  tcase_add_test(tc_pool, grow_while_dispatching);
 
   return suite;
 }